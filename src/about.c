@@ -51,6 +51,7 @@ const char     modes[] =
         " -> [1] Production : full report and CSV update            \n"
         " -> [2] Testing    : full report without CSV update        \n"
         " -> [3] Single     : single tests and debug info on screen \n"
+        " -> [4] Multi      : production on several stations at once\n"
 ;
 
 const char copyright[] =
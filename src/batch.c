@@ -0,0 +1,380 @@
+// -----------------------------------------------------------------------------
+// BATCH_C
+//
+// - Headless batch mode, which tests the PCBAs listed in a job file (or a
+//   single one described by the command line arguments) back to back, without
+//   console setup nor user input, for scripts and automated rigs
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  <stddef.h>
+#include  "public.h"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   JOB_LINE_SIZE                                                     1024
+#define   JOB_SEPS                                                    " \t\r\n"
+#define   JOB_COMMENT                                                        '#'
+#define   JOB_ANSWERS                                                     "YNyn"
+
+#define   MODE_PRODUCTION                                                    "1"
+#define   MODE_TESTING                                                       "2"
+
+#define   N_JOB_KEYS                           (sizeof(keys) / sizeof(keys[0]))
+
+// -------------------- Private data types declarations --------------------- //
+
+// -----------------------------------------------------------------------------
+// Key of a job that fills a data field of the session
+// -----------------------------------------------------------------------------
+typedef struct job_key {
+    const char *name;                    // Name of the key
+    size_t      off;                     // Offset of the field in the session
+    size_t      min_len;                 // Minimum length of the value
+    size_t      max_len;                 // Maximum length of the value
+    const char *charset;                 // Allowed charset or NULL if unused
+} job_key_t;
+
+// -----------------------------------------------------------------------------
+// Settings of the batch that are not kept in the session, and its progress
+// -----------------------------------------------------------------------------
+typedef struct batch {
+    char        mode[DEF_SMA_BUF_SIZE];  // Operation mode: 1 or 2
+    char        ans[DEF_SMA_BUF_SIZE];   // Answers to the questions, in order
+    char        job[DEF_SMA_BUF_SIZE];   // Job file path or ""
+    char      target[DEF_BIG_BUF_SIZE];  // Target of the link in use
+    int         code;                    // Exit code so far
+    DWORD       n_boards;                // Number of PCBAs run
+    DWORD       n_pass;                  // Number of PCBAs that passed
+} batch_t;
+
+// --------------- Public global data holders initializations --------------- //
+
+// -------------- Private global data holders initializations --------------- //
+
+static const job_key_t keys[] = {
+#if       (ETH == 1)
+    {"addr",   offsetof(hwtt_session_t, addr),   MIN_IPV4_ADDR_LEN,
+            MAX_IPV4_ADDR_LEN, num_dot},
+    {"port",   offsetof(hwtt_session_t, port),   MIN_TCP_PORT_LEN,
+            MAX_TCP_PORT_LEN,  numbers},
+    {"baud",   offsetof(hwtt_session_t, baud),   0, 0, NULL},
+    {"parity", offsetof(hwtt_session_t, parity), 0, 0, NULL},
+    {"stop",   offsetof(hwtt_session_t, stop),   0, 0, NULL},
+#else  // (ETH == 1)
+    {"addr",   offsetof(hwtt_session_t, addr),   MIN_COM_PORT_LEN,
+            MAX_COM_PORT_LEN,  alphnum},
+    {"port",   offsetof(hwtt_session_t, port),   0, 0, NULL},
+    {"baud",   offsetof(hwtt_session_t, baud),   MIN_BAUD_LEN,
+            MAX_BAUD_LEN,      numbers},
+    {"parity", offsetof(hwtt_session_t, parity), PARITY_LEN,
+            PARITY_LEN,        PARITIES},
+    {"stop",   offsetof(hwtt_session_t, stop),   MIN_STOP_LEN,
+            MAX_STOP_LEN,      num_dot},
+#endif // (ETH == 1)
+    {"user",   offsetof(hwtt_session_t, user),   MIN_USER_LEN,
+            MAX_USER_LEN,      all},
+    {"comp",   offsetof(hwtt_session_t, comp),   MIN_COMP_LEN,
+            MAX_COMP_LEN,      all},
+    {"bn",     offsetof(hwtt_session_t, bn),     MIN_BN_LEN,
+            MAX_BN_LEN,        numbers},
+    {"sn",     offsetof(hwtt_session_t, sn),     MIN_SN_LEN,
+            MAX_SN_LEN,        numbers}
+};
+
+// --------------------- Private functions declarations --------------------- //
+
+static int run_job(hwtt_session_t *ses, batch_t *b, int dry);
+static void run_board(hwtt_session_t *ses, batch_t *b);
+static int check_board(const hwtt_session_t *ses);
+static int set_key(hwtt_session_t *ses, batch_t *b, const char *tok,
+        int args);
+static int check_val(const job_key_t *key, const char *val);
+static int is_key(const char *tok, size_t len, const char *key);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+int run_batch(int argc, char *argv[]) {
+    // Enter the headless mode with a quiet session, whose details go only to
+    // the TXT reports.
+    set_headless();
+    static hwtt_session_t ses = {0};
+    static batch_t b = {0};
+    init_session(&ses, NULL);
+    sprintf(b.mode, "%s", MODE_PRODUCTION);
+
+    // Take the settings of the arguments, which may name a job file.
+    for (int i = 1; i < argc; i++) {
+        int ret = set_key(&ses, &b, argv[i], TRUE);
+        if (ret != 0) {
+            fprintf(stderr, "Invalid argument \"%s\".\n", argv[i]);
+
+            return EXIT_BAD_JOB;
+        }
+    }
+    if (*b.job == 0 && *ses.sn == 0) {
+        fprintf(stderr, "Neither a job file nor a serial number was given.\n");
+
+        return EXIT_BAD_JOB;
+    }
+
+    // Check the whole job before testing any PCBA, on copies of the settings
+    // so that it starts again from the ones of the arguments, as nobody could
+    // fix an invalid field once the PCBAs are being tested.
+    int ret = 0;
+    if (*b.job != 0) {
+        static hwtt_session_t dry_ses = {0};
+        static batch_t dry_b = {0};
+        dry_ses = ses;
+        dry_b   = b;
+        ret = run_job(&dry_ses, &dry_b, TRUE);
+    } else {
+        ret = check_board(&ses);
+    }
+    if (ret != 0) {
+        return EXIT_BAD_JOB;
+    }
+
+    // Test the PCBAs of the job file, or the single one of the arguments, and
+    // wait until all the reports are saved.
+    init_writer();
+    if (*b.job != 0) {
+        ret = run_job(&ses, &b, FALSE);
+    } else {
+        run_board(&ses, &b);
+    }
+    close_link(&ses);
+    shut_writer(stdout);
+
+    // Print the summary of the batch and end with its exit code.
+    char msg[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(msg, "PCBAs tested : %lu, passed : %lu", b.n_boards, b.n_pass);
+    output(stdout, NULL, msg);
+    output(stdout, NULL, "\n");
+    if (ret != 0) {
+        return EXIT_BAD_JOB;
+    }
+
+    return b.code;
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+static int run_job(hwtt_session_t *ses, batch_t *b, int dry) {
+    // Open the job file.
+    FILE *f = fopen(b->job, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "The job file \"%s\" could not be opened.\n", b->job);
+
+        return 1;
+    }
+
+    // Take its lines in order: the keys of every line (whitespace separated,
+    // and up to a comment) update the settings, and a line with a serial
+    // number is a PCBA, which is tested right away with the current ones (or
+    // only checked in a dry run).
+    char line[JOB_LINE_SIZE] = {0};
+    int  ret = 0;
+    for (DWORD n = 1; ret == 0 && fgets(line, sizeof(line), f) != NULL; n++) {
+        size_t len = strlen(line);
+        if (len == sizeof(line) - NULL_TERMIN_SIZE && line[len - 1] != '\n') {
+            fprintf(stderr, "Line %lu of the job file is too long.\n", n);
+            ret = 1;
+            break;
+        }
+        char *hash = strchr(line, JOB_COMMENT);
+        if (hash != NULL) {
+            *hash = 0;
+        }
+        int board = FALSE;
+        char *tok = strtok(line, JOB_SEPS);
+        while (tok != NULL) {
+            ret = set_key(ses, b, tok, FALSE);
+            if (ret != 0) {
+                fprintf(stderr, "Invalid item \"%s\" in line %lu of the job fi"
+                        "le.\n", tok, n);
+                break;
+            }
+            if (strncmp(tok, "sn=", strlen("sn=")) == 0) {
+                board = TRUE;
+            }
+            tok = strtok(NULL, JOB_SEPS);
+        }
+        if (ret == 0 && board == TRUE && dry == TRUE) {
+            ret = check_board(ses);
+            if (ret != 0) {
+                fprintf(stderr, "Invalid PCBA in line %lu of the job file.\n",
+                        n);
+            }
+        } else if (ret == 0 && board == TRUE) {
+            run_board(ses, b);
+        }
+    }
+    fclose(f);
+
+    return ret;
+}
+
+static void run_board(hwtt_session_t *ses, batch_t *b) {
+    // Close the link of the previous PCBA if this one is in another target.
+    char target[DEF_BIG_BUF_SIZE] = {0};
+    sprintf(target, "%s:%s:%s:%s:%s", ses->addr, ses->port, ses->baud,
+            ses->parity, ses->stop);
+    if (strcmp(target, b->target) != 0) {
+        close_link(ses);
+        sprintf(b->target, "%s", target);
+    }
+
+    // Hand the answers over to the tests with question, in order (a missing
+    // answer is a No).
+    const char *ans = b->ans;
+    for (int i = 0; i < N_TESTS; i++) {
+        ses->answer[i] = 0;
+        if (*question[i] == 0) {
+            continue;
+        }
+        ses->answer[i] = (*ans == 'Y' || *ans == 'y') ? 'Y' : 'N';
+        if (*ans != 0) {
+            ans++;
+        }
+    }
+
+    // Test the PCBA in the selected mode.
+    ses->file[0] = 0;
+    ses->all_ok  = TRUE;
+    run_full(ses, (strcmp(b->mode, MODE_PRODUCTION) == 0) ? TRUE : FALSE);
+
+    // Print its whole result in a line, and keep the worst exit code: a PCBA
+    // without saved TXT report could not be tested.
+    const char *res = "OK";
+    int code = EXIT_ALL_PASS;
+    if (*ses->file == 0) {
+        res  = "NOT TESTED";
+        code = EXIT_NOT_TESTED;
+    } else if (ses->all_ok == FALSE) {
+        res  = "ERROR";
+        code = EXIT_SOME_FAIL;
+    } else {
+        b->n_pass++;
+    }
+    if (code > b->code) {
+        b->code = code;
+    }
+    b->n_boards++;
+    char msg[DEF_BIG_BUF_SIZE] = {0};
+    sprintf(msg, "%s_%s : %s", ses->bn, ses->sn, res);
+    output(stdout, NULL, msg);
+    output(stdout, NULL, "\n");
+    fflush(stdout);
+}
+
+static int check_board(const hwtt_session_t *ses) {
+    // Check every data field used by this build, including the predefined ones
+    // that were not given, as the user input would do.
+    int ret = 0;
+    for (size_t i = 0; i < N_JOB_KEYS; i++) {
+        const char *field = (const char *)ses + keys[i].off;
+        if (check_val(&keys[i], field) != 0) {
+            fprintf(stderr, "Invalid value \"%s\" for the key \"%s\".\n",
+                    field, keys[i].name);
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
+
+static int set_key(hwtt_session_t *ses, batch_t *b, const char *tok,
+        int args) {
+    // Split the key and the value, which must fit in the fields.
+    const char *val = strchr(tok, '=');
+    if (val == NULL || val == tok) {
+        return 1;
+    }
+    size_t len = val - tok;
+    val++;
+    if (strlen(val) >= DEF_SMA_BUF_SIZE) {
+        return 1;
+    }
+
+    // Take the settings of the batch (the job file only in the arguments).
+    if (is_key(tok, len, "mode") == TRUE) {
+        if (    strcmp(val, MODE_PRODUCTION) != 0 &&
+                strcmp(val, MODE_TESTING)    != 0) {
+            return 1;
+        }
+        sprintf(b->mode, "%s", val);
+
+        return 0;
+    }
+    if (is_key(tok, len, "answers") == TRUE) {
+        if (strspn(val, JOB_ANSWERS) != strlen(val)) {
+            return 1;
+        }
+        sprintf(b->ans, "%s", val);
+
+        return 0;
+    }
+    if (is_key(tok, len, "job") == TRUE && args == TRUE) {
+        sprintf(b->job, "%s", val);
+
+        return 0;
+    }
+
+    // Fill the data fields of the session, which are checked as if they were
+    // entered by the user.
+    for (size_t i = 0; i < N_JOB_KEYS; i++) {
+        if (is_key(tok, len, keys[i].name) == TRUE) {
+            if (check_val(&keys[i], val) != 0) {
+                return 1;
+            }
+            char *field = (char *)ses + keys[i].off;
+            sprintf(field, "%s", val);
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int check_val(const job_key_t *key, const char *val) {
+    // Check a value against the lengths and the charset of its field, unless
+    // the field is not used by this build.
+    size_t len = strlen(val);
+    if (key->charset == NULL) {
+        return 0;
+    }
+    if (    len < key->min_len || len > key->max_len ||
+            strspn(val, key->charset) != len) {
+        return 1;
+    }
+
+    return 0;
+}
+
+static int is_key(const char *tok, size_t len, const char *key) {
+    // Tell if the key of an item is the given one.
+    if (strlen(key) != len || strncmp(tok, key, len) != 0) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32
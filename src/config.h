@@ -31,6 +31,81 @@
 #define   ETH                                                                  1
 #define   PCBA_VERSION                                "MY_BOARD_REV_1_0_FW_1_00"
 #define   N_TESTS                                                              6
+#define   MAX_STATIONS                                                         8
+
+// -----------------------------------------------------------------------------
+// Pipelined requests: maximum number of consecutive tests without prompt nor
+// question whose requests are sent before receiving the responses (0 or 1 to
+// wait for every response before sending the next request)
+// -----------------------------------------------------------------------------
+#define   PIPELINE_WINDOW                                                      0
+
+// -----------------------------------------------------------------------------
+// Deadlines, in milliseconds: to send a request and receive its response (for
+// the tests whose timeout is 0 in the tests file) and to connect to the PCBA
+// -----------------------------------------------------------------------------
+#define   DEF_TIMEOUT_MS                                                    5000
+#define   CONN_TIMEOUT_MS                                                   3000
+
+// -----------------------------------------------------------------------------
+// Serial port baud rate proposed to the PCBA after the initial handshake (0 to
+// keep the entered one, for PCBAs that do not support the negotiation)
+// -----------------------------------------------------------------------------
+#define   NEG_BAUD_RATE                                                        0
+
+// -----------------------------------------------------------------------------
+// Downloads of files to the PCBA: bytes per chunk and maximum number of chunks
+// sent without acknowledgement
+// -----------------------------------------------------------------------------
+#define   DL_CHUNK_SIZE                                                      256
+#define   DL_WINDOW                                                            8
+
+// -----------------------------------------------------------------------------
+// Link probe when a link is opened: number of timed echo round trips (0 to skip
+// the probe) and bytes sent and received to measure the throughput (before
+// CONN_TIMEOUT_MS). The link fails if the 95th percentile of the round trips,
+// in microseconds, is above its limit or a throughput, in bytes per second, is
+// below its limit (0 for no limit)
+// -----------------------------------------------------------------------------
+#define   PROBE_ECHOES                                                         0
+#define   PROBE_SIZE                                                        1024
+#define   PROBE_MAX_RTT_US                                                     0
+#define   PROBE_MIN_RATE                                                       0
+
+// -----------------------------------------------------------------------------
+// Heartbeats sent to the PCBA while the user reads a prompt or a question, to
+// detect a lost link before the next request: period in milliseconds (0 to
+// disable them)
+// -----------------------------------------------------------------------------
+#define   HEARTBEAT_MS                                                         0
+
+// -----------------------------------------------------------------------------
+// Binary response frames proposed to the PCBA when the link is opened (0 to
+// keep the ASCII responses, for PCBAs that do not support them)
+// -----------------------------------------------------------------------------
+#define   BIN_FRAMES                                                           0
+
+// -----------------------------------------------------------------------------
+// Cycle time profiler: split of the wall time of every full run into operator
+// input, link I/O, file I/O and console output, shown at its end and appended
+// to a profile log with the totals of the whole session (0 to disable it)
+// -----------------------------------------------------------------------------
+#define   PROFILE                                                              0
+
+// -----------------------------------------------------------------------------
+// Multi-station dashboard: period, in milliseconds, at which the status of the
+// stations is redrawn while they are testing (0 to disable it)
+// -----------------------------------------------------------------------------
+#define   DASHBOARD_MS                                                         0
+
+// -----------------------------------------------------------------------------
+// Barcode scanner input: the data fields are read as whole lines, keeping the
+// keystrokes typed ahead, and a single scan may fill consecutive fields (like
+// the batch number and the serial number) separated by the delimiter (0 to
+// read the keyboard key by key)
+// -----------------------------------------------------------------------------
+#define   SCAN_INPUT                                                           0
+#define   SCAN_DELIM                                                         '/'
 
 // -----------------------------------------------------------------------------
 // Default data fields
@@ -42,6 +117,9 @@
 #define   DEF_IPV4_ADDR                                                       ""
 #define   DEF_TCP_PORT                                                        ""
 #define   DEF_COM_PORT                                                     "COM"
+#define   DEF_BAUD_RATE                                                   "9600"
+#define   DEF_PARITY                                                         "N"
+#define   DEF_STOP_BITS                                                      "1"
 
 // --------------------- Public data types declarations --------------------- //
 
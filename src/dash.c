@@ -0,0 +1,187 @@
+// -----------------------------------------------------------------------------
+// DASH_C
+//
+// - Multi-station dashboard, which shows a row with the status of every station
+//   while they are testing, rewriting only the cells of the console that change
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  "public.h"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   DASH_HEAD_ROWS                                                       2
+#define   DASH_MAX_ROWS                          (DASH_HEAD_ROWS + MAX_STATIONS)
+#define   DASH_ROW_LEN                                           (CMD_WIDTH - 1)
+
+#define   S_IN_ONE_MIN                                                        60
+#define   MAX_DASH_MINS                                                      999
+
+// -------------------- Private data types declarations --------------------- //
+
+// --------------- Public global data holders initializations --------------- //
+
+// -------------- Private global data holders initializations --------------- //
+
+static const char dash_head[] = " St    Test    Elapsed   Last       "
+        " Pass     Fail";
+
+static char  shown[DASH_MAX_ROWS][DASH_ROW_LEN] = {0};
+static int   n_shown = 0;
+static SHORT top     = 0;
+static COORD after   = {0};
+
+// --------------------- Private functions declarations --------------------- //
+
+static void get_cells(const hwtt_session_t *ses, char *row);
+static void put_cells(char *row, const char *str);
+static void draw_all(char grid[][DASH_ROW_LEN], int n_rows);
+static void draw_diff(char grid[][DASH_ROW_LEN], int n_rows);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+void init_dash(void) {
+    // Forget the drawn dashboard.
+    n_shown = 0;
+}
+
+void show_dash(const hwtt_session_t *st, int n_st) {
+    // Build the rows of the dashboard, padded with spaces: the title of every
+    // column, a line of dashes and a row per station.
+    char grid[DASH_MAX_ROWS][DASH_ROW_LEN] = {0};
+    memset(grid, ' ', sizeof(grid));
+    int n_rows = DASH_HEAD_ROWS + n_st;
+    put_cells(grid[0], dash_head);
+    memset(&grid[1][1], '-', DASH_ROW_LEN - 1);
+    for (int i = 0; i < n_st; i++) {
+        get_cells(&st[i], grid[DASH_HEAD_ROWS + i]);
+    }
+
+    // Take the console, and print the whole dashboard if it was not drawn yet
+    // or if something was printed after it (as a prompt of a station), which
+    // moved the cursor. Otherwise, rewrite only the changed cells in place.
+    lock_console();
+    show_frame(stdout);
+    HANDLE hConsoleOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    CONSOLE_SCREEN_BUFFER_INFO csbiInfo = {0};
+    GetConsoleScreenBufferInfo(hConsoleOutput, &csbiInfo);
+    if (    n_shown != n_rows                      ||
+            csbiInfo.dwCursorPosition.X != after.X ||
+            csbiInfo.dwCursorPosition.Y != after.Y) {
+        draw_all(grid, n_rows);
+    } else {
+        draw_diff(grid, n_rows);
+    }
+    unlock_console();
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+static void get_cells(const hwtt_session_t *ses, char *row) {
+    // Get the cells of a station: its number, the test in execution, the time
+    // since it started testing the PCBA (until it ended), the result of the
+    // last finished test and the whole results of the PCBAs since the start.
+    const station_stat_t *s = &ses->stat;
+    char test[DEF_SMA_BUF_SIZE] = "--";
+    LONG num = s->test;
+    if (num != STAT_NO_TEST) {
+        sprintf(test, "%02li", num);
+    }
+    char time[DEF_SMA_BUF_SIZE] = "--:--";
+    LONGLONG beg = s->beg;
+    LONGLONG end = s->end;
+    if (beg != 0) {
+        if (end == 0) {
+            end = get_stamp();
+        }
+        LARGE_INTEGER freq = {0};
+        QueryPerformanceFrequency(&freq);
+        LONGLONG secs = (end - beg) / freq.QuadPart;
+        LONGLONG mins = secs / S_IN_ONE_MIN;
+        if (mins > MAX_DASH_MINS) {
+            mins = MAX_DASH_MINS;
+        }
+        sprintf(time, "%lli:%02lli", mins, secs % S_IN_ONE_MIN);
+    }
+    const char *last = "--";
+    if (s->last == TEST_RES_PASS) {
+        last = "PASS";
+    } else if (s->last == TEST_RES_FAIL) {
+        last = "FAIL";
+    } else if (s->last == TEST_RES_TIMEOUT) {
+        last = "TIMEOUT";
+    }
+    char buf[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(buf, " %02i    %-5s  %8s   %-7s  %7li  %7li", ses->station, test,
+            time, last, s->n_pass, s->n_fail);
+    put_cells(row, buf);
+}
+
+static void put_cells(char *row, const char *str) {
+    // Copy a string to a row, without its NULL terminator (the rest of the row
+    // keeps its spaces).
+    size_t len = strlen(str);
+    if (len > DASH_ROW_LEN) {
+        len = DASH_ROW_LEN;
+    }
+    memcpy(row, str, len);
+}
+
+static void draw_all(char grid[][DASH_ROW_LEN], int n_rows) {
+    // Print every row at the cursor, as a single frame, and note where the
+    // dashboard starts and where the cursor is left after it.
+    output(stdout, NULL, "\n");
+    for (int i = 0; i < n_rows; i++) {
+        output_buf(stdout, NULL, grid[i], DASH_ROW_LEN);
+        output(stdout, NULL, "\n");
+    }
+    show_frame(stdout);
+    HANDLE hConsoleOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    CONSOLE_SCREEN_BUFFER_INFO csbiInfo = {0};
+    GetConsoleScreenBufferInfo(hConsoleOutput, &csbiInfo);
+    after = csbiInfo.dwCursorPosition;
+    top   = after.Y - n_rows;
+    memcpy(shown, grid, n_rows * DASH_ROW_LEN);
+    n_shown = n_rows;
+}
+
+static void draw_diff(char grid[][DASH_ROW_LEN], int n_rows) {
+    // Rewrite in place the span of every row between its first and its last
+    // changed cells, leaving the cursor where it is.
+    HANDLE hConsoleOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    for (int i = 0; i < n_rows; i++) {
+        int first = 0;
+        int last  = DASH_ROW_LEN - 1;
+        while (first <= last && grid[i][first] == shown[i][first]) {
+            first++;
+        }
+        while (last >= first && grid[i][last] == shown[i][last]) {
+            last--;
+        }
+        if (first > last) {
+            continue;
+        }
+        COORD dwWriteCoord = {.X = first, .Y = top + i};
+        DWORD n_wrt = 0;
+        WriteConsoleOutputCharacterA(hConsoleOutput, &grid[i][first],
+                last - first + 1, dwWriteCoord, &n_wrt);
+        memcpy(&shown[i][first], &grid[i][first], last - first + 1);
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32
@@ -26,12 +26,6 @@
 
 // ---------------------- Private preprocessor macros ----------------------- //
 
-#define   MIN_IPV4_ADDR_LEN                                                    7
-#define   MAX_IPV4_ADDR_LEN                                                   15
-
-#define   MIN_TCP_PORT_LEN                                                     1
-#define   MAX_TCP_PORT_LEN                                                     5
-
 #define   MIN_TCP_PORT_NUM                                                     1
 #define   MAX_TCP_PORT_NUM                                                 65535
 
@@ -39,6 +33,9 @@
 #define   WSA_SUBVERSION                                                       2
 #define   WSA_VALUE           (WSA_VERSION << BITS_IN_ONE_BYTE) | WSA_SUBVERSION
 
+#define   MS_IN_ONE_S                                                       1000
+#define   US_IN_ONE_MS                                                      1000
+
 // -------------------- Private data types declarations --------------------- //
 
 // --------------- Public global data holders initializations --------------- //
@@ -47,116 +44,129 @@ const char coms[] = "ETH";
 
 // -------------- Private global data holders initializations --------------- //
 
-static int s = 0;
-
 // --------------------- Private functions declarations --------------------- //
 
+static int wait_sock(hwtt_session_t *ses, int wr, DWORD ms);
+
 // ---------------------- Public functions definitions ---------------------- //
 
-int init_coms(void) {
+int init_coms(hwtt_session_t *ses) {
     // Setup the communications.
-    write_header(stdout, report, "Ethernet Communications Setup");
+    write_header(ses->cmd, ses->report, "Ethernet Communications Setup");
 
     // Request the IPv4 address of the PCBA to be tested.
     const  char ip_addr_fie[] = " <- Remote IPv4 address       : ";
-    static char ip_addr_dat[MAX_IPV4_ADDR_LEN + NULL_TERMIN_SIZE] = {
-            DEF_IPV4_ADDR
-    };
+    char       *ip_addr_dat = ses->addr;
     size_t      ip_addr_len = strlen(ip_addr_dat);
-    input(stdout, report, ip_addr_fie, ip_addr_dat, ip_addr_len,
+    input(ses->cmd, ses->report, ip_addr_fie, ip_addr_dat, ip_addr_len,
             MIN_IPV4_ADDR_LEN, MAX_IPV4_ADDR_LEN, num_dot);
 
     // Check if the entered IPv4 address is valid.
-    output(stdout, report, " -> Checking IPv4 address ..... ");
+    output(ses->cmd, ses->report, " -> Checking IPv4 address ..... ");
     char dummy[DEF_SMA_BUF_SIZE] = {0};
-    ret = inet_pton(AF_INET, ip_addr_dat, dummy);
+    int ret = inet_pton(AF_INET, ip_addr_dat, dummy);
     if (ret == 0) {
-        output(stdout, report, error_msg);
-        output(stdout, report, "\n");
-        print_error("Invalid IPv4 address.");
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, "Invalid IPv4 address.");
 
         return 1;
     }
-    output(stdout, report, ok_msg);
-    output(stdout, report, "\n");
-    output(stdout, report, "\n");
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
+    output(ses->cmd, ses->report, "\n");
 
     // Request the TCP port of the PCBA to be tested.
     const  char tcp_port_fie[] = " <- Remote TCP port           : ";
-    static char tcp_port_dat[MAX_TCP_PORT_LEN + NULL_TERMIN_SIZE] = {
-            DEF_TCP_PORT
-    };
+    char       *tcp_port_dat = ses->port;
     size_t      tcp_port_len = strlen(tcp_port_dat);
-    input(stdout, report, tcp_port_fie, tcp_port_dat, tcp_port_len,
+    input(ses->cmd, ses->report, tcp_port_fie, tcp_port_dat, tcp_port_len,
             MIN_TCP_PORT_LEN, MAX_TCP_PORT_LEN, numbers);
 
     // Check if the entered TCP port is valid.
-    output(stdout, report, " -> Checking TCP port ......... ");
+    output(ses->cmd, ses->report, " -> Checking TCP port ......... ");
     int tcp_port_num = atoi(tcp_port_dat);
     if (tcp_port_num < MIN_TCP_PORT_NUM || tcp_port_num > MAX_TCP_PORT_NUM) {
-        output(stdout, report, error_msg);
-        output(stdout, report, "\n");
-        print_error("Invalid TCP port.");
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, "Invalid TCP port.");
 
         return 1;
     }
-    output(stdout, report, ok_msg);
-    output(stdout, report, "\n");
-    output(stdout, report, "\n");
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
+    output(ses->cmd, ses->report, "\n");
 
     // Initialize the TCP/IP stack.
-    output(stdout, report, " -> Initializing TCP/IP ....... ");
+    output(ses->cmd, ses->report, " -> Initializing TCP/IP ....... ");
     WSADATA wsaData = {0};
     ret = WSAStartup(WSA_VALUE, &wsaData);
     if (ret != 0) {
-        output(stdout, report, error_msg);
-        output(stdout, report, "\n");
-        print_error(NULL);
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
 
         return 1;
     }
-    output(stdout, report, ok_msg);
-    output(stdout, report, "\n");
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
 
     // Create the socket.
-    output(stdout, report, " -> Creating the socket ....... ");
-    s = socket(AF_INET, SOCK_STREAM, 0);
-    if (s == INVALID_SOCKET) {
-        output(stdout, report, error_msg);
-        output(stdout, report, "\n");
-        print_error(NULL);
+    output(ses->cmd, ses->report, " -> Creating the socket ....... ");
+    ses->s = socket(AF_INET, SOCK_STREAM, 0);
+    if (ses->s == INVALID_SOCKET) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
         WSACleanup();
 
         return 1;
     }
-    output(stdout, report, ok_msg);
-    output(stdout, report, "\n");
-
-    // Connect to the tested PCBA.
-    output(stdout, report, " -> Connecting to server ...... ");
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
+
+    // Let the TCP/IP stack detect a dead connection while it is kept open
+    // between executions, and make the socket non-blocking, so that every
+    // operation waits for it with the deadline of the session.
+    BOOL keep_alive = TRUE;
+    setsockopt(ses->s, SOL_SOCKET, SO_KEEPALIVE, (char *)&keep_alive,
+            sizeof(keep_alive));
+    u_long non_blocking = TRUE;
+    ioctlsocket(ses->s, FIONBIO, &non_blocking);
+
+    // Connect to the tested PCBA, giving up after CONN_TIMEOUT_MS.
+    output(ses->cmd, ses->report, " -> Connecting to server ...... ");
     struct sockaddr_in dst = {
         .sin_family      = AF_INET,
         .sin_port        = htons(tcp_port_num),
         .sin_addr.s_addr = inet_addr(ip_addr_dat)
     };
-    ret = connect(s, (struct sockaddr *)&dst, sizeof(dst));
-    if (ret == SOCKET_ERROR) {
-        output(stdout, report, error_msg);
-        output(stdout, report, "\n");
-        print_error(NULL);
+    set_deadline(ses, CONN_TIMEOUT_MS);
+    show_frame(ses->cmd);
+    ret = connect(ses->s, (struct sockaddr *)&dst, sizeof(dst));
+    if (ret == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+        ret = wait_sock(ses, TRUE, get_remaining(ses));
+    }
+    if (ret != 0) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
+        closesocket(ses->s);
         WSACleanup();
 
         return 1;
     }
-    output(stdout, report, ok_msg);
-    output(stdout, report, "\n");
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
 
     return 0;
 }
 
-int shut_coms(void) {
+int shut_coms(hwtt_session_t *ses) {
     // End the connection.
-    ret = WSACleanup();
+    closesocket(ses->s);
+    ses->s = INVALID_SOCKET;
+    int ret = WSACleanup();
     if (ret != 0) {
         return 1;
     }
@@ -164,28 +174,112 @@ int shut_coms(void) {
     return 0;
 }
 
-int send_buf(const char *buf, size_t len) {
-    // Send a buffer of len number of bytes.
-    ret = send(s, buf, len, 0);
-    if (ret == SOCKET_ERROR) {
+int check_coms(hwtt_session_t *ses) {
+    // Check that the socket has no pending errors.
+    int err = 0;
+    int err_len = sizeof(err);
+    int ret = getsockopt(ses->s, SOL_SOCKET, SO_ERROR, (char *)&err, &err_len);
+    if (ret == SOCKET_ERROR || err != 0) {
         return 1;
     }
 
+    // The pending received bytes are not read here, as the reader thread does
+    // it, and it also detects when the PCBA closes the connection.
+    return 0;
+}
+
+int send_buf(hwtt_session_t *ses, const char *buf, size_t len) {
+    // Send a buffer of len number of bytes, waiting for room in the socket
+    // buffer when it is full.
+    while (len > 0) {
+        int ret = send(ses->s, buf, len, 0);
+        if (ret == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK) {
+            return 1;
+        }
+        if (ret == SOCKET_ERROR) {
+            ret = wait_sock(ses, TRUE, get_remaining(ses));
+            if (ret != 0) {
+                return ret;
+            }
+            continue;
+        }
+        buf += ret;
+        len -= ret;
+    }
+
     return 0;
 }
 
-int recv_buf(char *buf, size_t len) {
-    // Receive a buffer of len number of bytes.
-    ret = recv(s, buf, len, 0);
+int read_coms(hwtt_session_t *ses, char *buf, size_t len, size_t *n_rcv) {
+    // Read up to len number of bytes, waiting for them until the deadline of
+    // the session at most (the poller thread only reads a readable socket). A
+    // graceful close of the connection by the PCBA is a failure, as nothing
+    // else will arrive.
+    *n_rcv = 0;
+    int ret = wait_sock(ses, FALSE, get_remaining(ses));
+    if (ret == COMS_TIMEOUT) {
+        return 0;
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    ret = recv(ses->s, buf, len, 0);
     if (ret == SOCKET_ERROR) {
         return 1;
     }
+    if (ret == 0) {
+        WSASetLastError(WSAECONNRESET);
+
+        return 1;
+    }
+    *n_rcv = ret;
 
     return 0;
 }
 
 // --------------------- Private functions definitions ---------------------- //
 
+static int wait_sock(hwtt_session_t *ses, int wr, DWORD ms) {
+    // Wait until the socket is readable or writable (a pending connection is
+    // writable once established, or reports its failure as an exception) or
+    // until the given time (usually what is left until the deadline of the
+    // session) expires.
+    fd_set fds = {0};
+    fd_set exc = {0};
+    FD_ZERO(&fds);
+    FD_ZERO(&exc);
+    FD_SET(ses->s, &fds);
+    FD_SET(ses->s, &exc);
+    const struct timeval timeout = {
+        .tv_sec  = ms / MS_IN_ONE_S,
+        .tv_usec = ms % MS_IN_ONE_S * US_IN_ONE_MS
+    };
+    int ret = 0;
+    if (wr == TRUE) {
+        ret = select(0, NULL, &fds, &exc, &timeout);
+    } else {
+        ret = select(0, &fds, NULL, &exc, &timeout);
+    }
+    if (ret == SOCKET_ERROR) {
+        return 1;
+    }
+    if (ret == 0) {
+        WSASetLastError(WSAETIMEDOUT);
+
+        return COMS_TIMEOUT;
+    }
+    if (FD_ISSET(ses->s, &exc) != 0) {
+        int err = 0;
+        int err_len = sizeof(err);
+        getsockopt(ses->s, SOL_SOCKET, SO_ERROR, (char *)&err, &err_len);
+        WSASetLastError(err);
+
+        return 1;
+    }
+
+    return 0;
+}
+
 // -----------------------------------------------------------------------------
 
 #endif // (ETH == 1)
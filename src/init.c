@@ -34,12 +34,11 @@
 #define   BACK_T_N                                                             0
 #define   HWTT_T_N                                                             1
 
-#define   DELAY_MS                                                            50
-
 #define   CMD_HEIGHT                                                          43
 #define   CMD_SCROLL                                                        2048
+#define   CMD_BUF_SIZE                                                     65536
 
-#define   SEL_MODE_Y_POS                                                      35
+#define   SEL_MODE_Y_POS                                                      36
 
 // -------------------- Private data types declarations --------------------- //
 
@@ -51,30 +50,36 @@ static const char hwtt_title[] = "Hardware Test Tool";
 
 // --------------------- Private functions declarations --------------------- //
 
-static void back_thread(void);
 static void hwtt_thread(void);
 
 static void check_env(void);
 static void setup_cmd(void);
 static void clear_cmd(void);
 static void run_loop(void);
-static void prompt_error(const char *top, const char *msg);
 
 // ---------------------- Public functions definitions ---------------------- //
 
-int main(void) {
+int main(int argc, char *argv[]) {
+    // With arguments, run the headless mode, which neither uses the console
+    // window nor waits for the user, and ends with an exit code.
+    if (argc > 1) {
+        return run_batch(argc, argv);
+    }
+
     // Check if the system meets the minimum required operative system version
     // and display resolution.
     check_env();
 
-    // Create the threads: a background thread to detect if the program is
-    // running in full screen, killing it because it is not allowed; and the
-    // main thread, which performs the program's stuff.
+    // Create the threads: the supervisor thread, which kills the program if it
+    // is put in full screen (as it is not allowed) and watches the links while
+    // the user reads the prompts and questions (unless its event cannot be
+    // created); and the main thread, which performs the program's stuff.
+    init_super();
     HANDLE hdl[N_THEADS] = {0};
-    hdl[BACK_T_N] = CreateThread(NULL, 0, (void *)back_thread, NULL, 0, NULL);
+    hdl[BACK_T_N] = CreateThread(NULL, 0, (void *)super_thread, NULL, 0, NULL);
     hdl[HWTT_T_N] = CreateThread(NULL, 0, (void *)hwtt_thread, NULL, 0, NULL);
 
-    // Wait until the main thread finishes (the background thread never
+    // Wait until the main thread finishes (the supervisor thread never
     // finishes during the program's execution).
     WaitForMultipleObjects(N_THEADS, hdl, FALSE, INFINITE);
 
@@ -83,34 +88,6 @@ int main(void) {
 
 // --------------------- Private functions definitions ---------------------- //
 
-static void back_thread(void) {
-    // Run this thread infinitely.
-    for (;;) {
-        // Check if the dimensions of the console are equals of the ones of the
-        // display resolution. If they are equal, it is because the program is
-        // running in full screen, which is not allowed, so the program is
-        // killed after prompting an error.
-        HWND cons_hdle = GetConsoleWindow();
-        HWND desk_hdle = GetDesktopWindow();
-        RECT cons_rect = {0};
-        RECT desk_rect = {0};
-        GetWindowRect(cons_hdle, &cons_rect);
-        GetWindowRect(desk_hdle, &desk_rect);
-        if (    cons_rect.left   == desk_rect.left   &&
-                cons_rect.top    == desk_rect.top    &&
-                cons_rect.right  == desk_rect.right  &&
-                cons_rect.bottom == desk_rect.bottom) {
-            prompt_error(
-                    "Unsupported window mode",
-                    "Running this program in full screen is not allowed!"
-            );
-        }
-
-        // Delay 50 ms to avoid overloading the CPU.
-        Sleep(DELAY_MS);
-    }
-}
-
 static void hwtt_thread(void) {
     // Perform the console's window setup.
     setup_cmd();
@@ -155,7 +132,7 @@ static void check_env(void) {
     DWORD dwVersion = GetVersion();
     DWORD dwMajorVersion = (dwVersion >>                0) & LSBY;
     DWORD dwMinorVersion = (dwVersion >> BITS_IN_ONE_BYTE) & LSBY;
-    ret =    dwMajorVersion <  MIN_MAJ_V ||
+    int ret =    dwMajorVersion <  MIN_MAJ_V ||
             (dwMajorVersion == MIN_MAJ_V && dwMinorVersion < MIN_MEN_V);
     if (ret != 0) {
         prompt_error(
@@ -178,6 +155,11 @@ static void check_env(void) {
 }
 
 static void setup_cmd(void) {
+    // Buffer the screen output, which is shown at once at the end of every
+    // frame (before waiting for the user or for the link), instead of piece by
+    // piece.
+    setvbuf(stdout, NULL, _IOFBF, CMD_BUF_SIZE);
+
     // Disable the window manual resizing.
     HWND hWnd = GetConsoleWindow();
     int nIndex = GWL_STYLE;
@@ -214,7 +196,9 @@ static void setup_cmd(void) {
 }
 
 static void clear_cmd(void) {
-    // Get information of the window buffer.
+    // Show the pending output before it is cleared, and get information of the
+    // window buffer.
+    show_frame(stdout);
     HANDLE hConsoleOutput = GetStdHandle(STD_OUTPUT_HANDLE);
     CONSOLE_SCREEN_BUFFER_INFO stConsoleScreenBufferInfo = {0};
     GetConsoleScreenBufferInfo(hConsoleOutput, &stConsoleScreenBufferInfo);
@@ -246,8 +230,9 @@ static void clear_cmd(void) {
 }
 
 static void run_loop(void) {
-    // Rewind the screen (as an automatic scroll to the top) and then set the
-    // cursor after the mode selection menu.
+    // Show the whole start screen, rewind it (as an automatic scroll to the
+    // top) and then set the cursor after the mode selection menu.
+    show_frame(stdout);
     HANDLE hConsoleOutput = GetStdHandle(STD_OUTPUT_HANDLE);
     COORD dwCursorPosition = {0};
     SetConsoleCursorPosition(hConsoleOutput, dwCursorPosition);
@@ -256,12 +241,18 @@ static void run_loop(void) {
 
     // Ask for the mode to be used.
     const char mode_fie[] = " <- Select mode : ";
-    const char mode_opt[] = "123";
+    const char mode_opt[] = "1234";
     char       mode_dat[SINGLE_CHAR_SIZE + NULL_TERMIN_SIZE] = {0};
     size_t     mode_len = strlen(mode_dat);
     input(stdout, NULL, mode_fie, mode_dat, mode_len, SINGLE_CHAR_SIZE,
             SINGLE_CHAR_SIZE, mode_opt);
 
+    // Create the session, which remembers the data fields between iterations,
+    // and start the background writer that saves the reports.
+    static hwtt_session_t ses = {0};
+    init_session(&ses, stdout);
+    init_writer();
+
     // Perform the stuff, clearing the screen every time the selected mode is
     // executed. When finished, it is asked to the user if he wants to start
     // over (if not, the program finishes).
@@ -269,25 +260,22 @@ static void run_loop(void) {
     do {
         clear_cmd();
                if (*mode_dat == '1') {
-            run_full(TRUE);
+            run_full(&ses, TRUE);
         } else if (*mode_dat == '2') {
-            run_full(FALSE);
+            run_full(&ses, FALSE);
+        } else if (*mode_dat == '4') {
+            run_multi(&ses);
         } else {
-            run_single();
+            run_single(&ses);
         }
         ask_yes_no(stdout, NULL, " <- Start over? [Y/N] : ", &again);
     } while (again == YES);
-}
-
-static void prompt_error(const char *top, const char *msg) {
-    // Hide the console window.
-    ShowWindow(GetConsoleWindow(), SW_HIDE);
-
-    // Prompt the error message.
-    MessageBoxA(NULL, msg, top, MB_OK | MB_ICONERROR);
 
-    // End the program with failure.
-    exit(1);
+    // Close the links kept open between the executions, and wait until all the
+    // reports are saved.
+    close_link(&ses);
+    shut_multi();
+    shut_writer(stdout);
 }
 
 // -----------------------------------------------------------------------------
@@ -31,11 +31,14 @@
 
 #define   N_HEADER_SPACES                                                      4
 #define   N_HEADER_HALFS                                                       2
+#define   HEADER_BUF_SIZE                                (CMD_WIDTH + CMD_WIDTH)
 
 #define   CTRL_C_CHAR                                                       0x03
 #define   ALT_F4_CHAR_ONE                                                   0x00
 #define   ALT_F4_CHAR_TWO                                                   0x6B
 
+#define   SCAN_LINE_SIZE                                                     256
+
 // -------------------- Private data types declarations --------------------- //
 
 // --------------- Public global data holders initializations --------------- //
@@ -51,14 +54,20 @@ const char       all[] = LOWERCASE     UPPERCASE     NUMBERS     SPACE     DOT ;
 
 // -------------- Private global data holders initializations --------------- //
 
+static int headless = FALSE;
+
+static _Thread_local char pending[SCAN_LINE_SIZE] = {0};
+
 // --------------------- Private functions declarations --------------------- //
 
+static void scan_line(FILE *cmd, const char *field, char *data, size_t cur_len,
+        size_t min_len, size_t max_len, const char *charset);
+static size_t read_line(char *line);
+static void put_current(FILE *cmd, const char *data);
+
 // ---------------------- Public functions definitions ---------------------- //
 
 void write_header(FILE *cmd, FILE *txt, const char *title) {
-    // Skip an initial empty line.
-    output(stdout, report, "\n");
-
     // Determine the number of dashes to be printed.
     int len = strlen(title);
     int n_dashes = 0;
@@ -67,42 +76,31 @@ void write_header(FILE *cmd, FILE *txt, const char *title) {
     } else {
         n_dashes = CMD_WIDTH - N_HEADER_SPACES / N_HEADER_HALFS;
     }
-
-    // Print an initial space.
-    output(cmd, txt, " ");
-
-    // Print the left dashes.
-    for (int i = 0; i < n_dashes / N_HEADER_HALFS; i++) {
-        output(cmd, txt, "-");
+    if (n_dashes < 0) {
+        n_dashes = 0;
     }
-
-    // Print the header title (if exists).
+    int n_left  = n_dashes / N_HEADER_HALFS;
+    int n_right = n_dashes - n_left;
+
+    // Build the whole header in a buffer, so that it is printed at once: an
+    // empty line, an initial space, the left dashes, the header title between
+    // spaces (if exists), the right dashes (with an extra one if the number of
+    // dashes is odd) and a final empty line.
+    char buf[HEADER_BUF_SIZE] = {0};
+    int  pos = 0;
+    buf[pos++] = '\n';
+    buf[pos++] = ' ';
+    memset(&buf[pos], '-', n_left);
+    pos += n_left;
     if (len > 0) {
-        // Print a space between the left dashes and the header title.
-        output(cmd, txt, " ");
-
-        // Print the header title.
-        output(cmd, txt, title);
-
-        // Print a space between the header title and the right dashes.
-        output(cmd, txt, " ");
-    }
-
-    // Print the right dashes.
-    for (int i = 0; i < n_dashes / N_HEADER_HALFS; i++) {
-        output(cmd, txt, "-");
-    }
-
-    // Print an extra dash if the number of dashes is odd.
-    if (n_dashes % N_HEADER_HALFS != 0) {
-        output(cmd, txt, "-");
+        pos += snprintf(&buf[pos], sizeof(buf) - pos, " %.*s ",
+                (int)sizeof(buf) - pos - n_right - N_HEADER_SPACES, title);
     }
-
-    // End the header.
-    output(cmd, txt, "\n");
-
-    // Skip a final empty line.
-    output(cmd, txt, "\n");
+    memset(&buf[pos], '-', n_right);
+    pos += n_right;
+    buf[pos++] = '\n';
+    buf[pos++] = '\n';
+    output_buf(cmd, txt, buf, pos);
 }
 
 void show_version(FILE *cmd, FILE *txt) {
@@ -133,9 +131,15 @@ void show_version(FILE *cmd, FILE *txt) {
 
 void ask_yes_no(FILE *cmd, FILE *txt, const char *que, int *ans) {
     // Ask to the user a question that must be answered with Yes or No ([Y/N]).
+    // In the headless mode, the given answer is taken as entered.
     const char opt[] = "ynYN";
     char dat[SINGLE_CHAR_SIZE + NULL_TERMIN_SIZE] = {0};
-    input(cmd, txt, que, dat, ORIGIN, SINGLE_CHAR_SIZE, SINGLE_CHAR_SIZE, opt);
+    size_t len = ORIGIN;
+    if (headless == TRUE) {
+        *dat = (*ans == YES) ? 'Y' : 'N';
+        len  = SINGLE_CHAR_SIZE;
+    }
+    input(cmd, txt, que, dat, len, SINGLE_CHAR_SIZE, SINGLE_CHAR_SIZE, opt);
     if (*dat == 'y' || *dat == 'Y') {
         *ans = YES;
     } else {
@@ -145,14 +149,53 @@ void ask_yes_no(FILE *cmd, FILE *txt, const char *que, int *ans) {
 
 void input(FILE *cmd, FILE *txt, const char *field, char *data,
         size_t cur_len, size_t min_len, size_t max_len, const char *charset) {
-    // Print the field to be completed with the data to be input.
+    // Print the field to be completed with the data to be input. The whole
+    // input is profiled as operator time (except its screen output).
+    prof_mark_t pm = {0};
+    prof_mark(&pm);
     output(cmd, txt, field);
 
-    // Print the default data, if any.
-    if (max_len > 0) {
+    // Print the default data, if any (apart with the scanner input, as a
+    // scanned line replaces it instead of being appended).
+    if (max_len > 0 && SCAN_INPUT == 1 && headless == FALSE) {
+        put_current(cmd, data);
+    } else if (max_len > 0) {
         output(cmd, NULL, data);
     }
 
+    // In the headless mode, take the default data as entered, as nobody can
+    // type (the batch mode checked it before testing any PCBA).
+    if (headless == TRUE) {
+        if (max_len > 0) {
+            output(NULL, txt, data);
+        }
+        output(cmd, txt, "\n");
+        prof_add(&pm, PROF_OPERATOR);
+
+        return;
+    }
+
+    // Hand the buffered text file to the operating system before waiting for
+    // the user, who may take long or kill the program, and show the screen
+    // built so far.
+    if (txt != NULL) {
+        fflush(txt);
+    }
+    show_frame(cmd);
+
+    // With the scanner input, read whole lines keeping the keystrokes typed
+    // ahead, as a scanner may burst a label before the field is printed.
+    if (SCAN_INPUT == 1) {
+        scan_line(cmd, field, data, cur_len, min_len, max_len, charset);
+        if (max_len > 0) {
+            output(NULL, txt, data);
+        }
+        output(NULL, txt, "\n");
+        prof_add(&pm, PROF_OPERATOR);
+
+        return;
+    }
+
     // Clear the input buffer to avoid from being processed keystrokes that were
     // made before calling the function.
     HANDLE hConsoleInput = GetStdHandle(STD_INPUT_HANDLE);
@@ -161,7 +204,9 @@ void input(FILE *cmd, FILE *txt, const char *field, char *data,
     // Read characters entered on the keyboard until an ENTER keystroke is
     // detected or until the program is killed with Ctrl + C or Alt + F4.
     while (1) {
-        // Get a character from stdin (keyboard).
+        // Show the echo of the previous character and get a character from
+        // stdin (keyboard).
+        show_frame(cmd);
         unsigned int x = _getch();
 
         // If the inputted character was a space, convert it in an underscore.
@@ -196,6 +241,7 @@ void input(FILE *cmd, FILE *txt, const char *field, char *data,
             }
             SetConsoleCursorPosition(hConsoleOutput, dwCursorPosition);
             output(cmd, NULL, " ");
+            show_frame(cmd);
             SetConsoleCursorPosition(hConsoleOutput, dwCursorPosition);
             cur_len--;
             data[cur_len] = 0;
@@ -215,33 +261,188 @@ void input(FILE *cmd, FILE *txt, const char *field, char *data,
 
         // Detect CTRL + C keystrokes to kill the program.
         if (x == CTRL_C_CHAR) {
-            exit(1);
+            kill_program();
         }
 
         // Detect ALT + F4 keystrokes to kill the program.
         if (x == ALT_F4_CHAR_ONE) {
             unsigned int x = _getch();
             if (x == ALT_F4_CHAR_TWO) {
-                exit(1);
+                kill_program();
             }
         }
     }
+    prof_add(&pm, PROF_OPERATOR);
+}
+
+void set_headless(void) {
+    // Enter the headless mode, for the whole execution.
+    headless = TRUE;
+}
+
+int is_headless(void) {
+    // Tell if the program runs in the headless mode.
+    return headless;
+}
+
+void show_frame(FILE *cmd) {
+    // Hand the screen output buffered since the last frame to the console,
+    // with a single write.
+    if (cmd == NULL) {
+        return;
+    }
+    prof_mark_t pm = {0};
+    prof_mark(&pm);
+    fflush(cmd);
+    prof_add(&pm, PROF_CONSOLE);
 }
 
 void output(FILE *cmd, FILE *txt, const char *msg) {
     // Print a message to the screen.
+    prof_mark_t pm = {0};
     if (cmd != NULL) {
+        prof_mark(&pm);
         fprintf(cmd, "%s", msg);
+        prof_add(&pm, PROF_CONSOLE);
     }
 
     // Print a message to a text file.
     if (txt != NULL) {
+        prof_mark(&pm);
         fprintf(txt, "%s", msg);
+        prof_add(&pm, PROF_FILES);
+    }
+}
+
+void output_buf(FILE *cmd, FILE *txt, const char *buf, size_t len) {
+    // Print a buffer to the screen.
+    prof_mark_t pm = {0};
+    if (cmd != NULL) {
+        prof_mark(&pm);
+        fwrite(buf, 1, len, cmd);
+        prof_add(&pm, PROF_CONSOLE);
+    }
+
+    // Print a buffer to a text file.
+    if (txt != NULL) {
+        prof_mark(&pm);
+        fwrite(buf, 1, len, txt);
+        prof_add(&pm, PROF_FILES);
     }
 }
 
 // --------------------- Private functions definitions ---------------------- //
 
+static void scan_line(FILE *cmd, const char *field, char *data, size_t cur_len,
+        size_t min_len, size_t max_len, const char *charset) {
+    char line[SCAN_LINE_SIZE] = {0};
+    while (1) {
+        // Take the rest of the previous scan in a field with data (printing it
+        // as if it was entered), or read a new line.
+        size_t len = 0;
+        if (max_len > 0 && *pending != 0) {
+            len = sprintf(line, "%s", pending);
+            output(cmd, NULL, line);
+            output(cmd, NULL, "\n");
+        } else {
+            show_frame(cmd);
+            len = read_line(line);
+        }
+        *pending = 0;
+
+        // Keep what follows the delimiter for the next field.
+        char *delim = strchr(line, SCAN_DELIM);
+        if (delim != NULL) {
+            *delim = 0;
+            sprintf(pending, "%s", delim + 1);
+            len = delim - line;
+        }
+
+        // A field without data only waits for the ENTER keystroke (and drops
+        // the rest of a scan, which was not meant for it).
+        if (max_len == 0) {
+            *pending = 0;
+
+            return;
+        }
+
+        // An empty line keeps the current data, if it is allowed for the field
+        // (as the user or the company kept between PCBAs).
+        if (len == 0 && cur_len >= min_len && cur_len <= max_len) {
+            return;
+        }
+
+        // Otherwise, the line replaces the data (from a previous PCBA, which
+        // must not be joined to the new one), converting the spaces in
+        // underscores, if it is allowed for the field.
+        for (size_t i = 0; i < len; i++) {
+            if (line[i] == ' ') {
+                line[i] = '_';
+            }
+        }
+        if (    len > 0 && len >= min_len && len <= max_len &&
+                strspn(line, charset) == len) {
+            memcpy(data, line, len);
+            data[len] = 0;
+
+            return;
+        }
+
+        // Otherwise, discard it (and the rest of its scan) and ask again.
+        *pending = 0;
+        output(cmd, NULL, " -> Not valid for this field, enter it again!");
+        output(cmd, NULL, "\n");
+        output(cmd, NULL, field);
+        put_current(cmd, data);
+    }
+}
+
+static size_t read_line(char *line) {
+    // Let the console read and echo a whole line, with its own editing.
+    HANDLE hConsoleInput = GetStdHandle(STD_INPUT_HANDLE);
+    DWORD dwMode = 0;
+    GetConsoleMode(hConsoleInput, &dwMode);
+    SetConsoleMode(hConsoleInput, dwMode | ENABLE_LINE_INPUT |
+            ENABLE_ECHO_INPUT);
+
+    // Read until the end of the line, in as few calls as possible, dropping
+    // what does not fit in the buffer. The program is killed if the console
+    // cannot be read (like after CTRL + C).
+    size_t len = 0;
+    int    end = FALSE;
+    while (end == FALSE) {
+        char  buf[SCAN_LINE_SIZE] = {0};
+        DWORD n_rd = 0;
+        BOOL ret = ReadConsoleA(hConsoleInput, buf, sizeof(buf), &n_rd, NULL);
+        if (ret == FALSE || n_rd == 0) {
+            kill_program();
+        }
+        for (DWORD i = 0; i < n_rd; i++) {
+            if (buf[i] == '\n') {
+                end = TRUE;
+            } else if (buf[i] != '\r' && len < sizeof(buf) - NULL_TERMIN_SIZE) {
+                line[len] = buf[i];
+                len++;
+            }
+        }
+    }
+    line[len] = 0;
+    SetConsoleMode(hConsoleInput, dwMode);
+
+    return len;
+}
+
+static void put_current(FILE *cmd, const char *data) {
+    // Print the current data of a field between brackets, if any, which an
+    // empty line keeps.
+    if (*data == 0) {
+        return;
+    }
+    output(cmd, NULL, "[");
+    output(cmd, NULL, data);
+    output(cmd, NULL, "] ");
+}
+
 // -----------------------------------------------------------------------------
 
 #endif // WIN32
@@ -0,0 +1,322 @@
+// -----------------------------------------------------------------------------
+// LINK_C
+//
+// - Communications link manager, which keeps the link with the PCBA open
+//   between executions and reopens it only when it is not alive anymore
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  "public.h"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   PROBE_UP_CMD                                                 "HWTT_U_"
+#define   PROBE_DN_CMD                                                 "HWTT_D_"
+#define   PROBE_ACK                                                   "PROBE_OK"
+
+#define   PROBE_N_RTT                    ((PROBE_ECHOES > 0) ? PROBE_ECHOES : 1)
+#define   PROBE_P50                                                           50
+#define   PROBE_P95                                                           95
+#define   PERCENT                                                            100
+
+#define   US_IN_ONE_S                                                    1000000
+
+// -------------------- Private data types declarations --------------------- //
+
+// --------------- Public global data holders initializations --------------- //
+
+// -------------- Private global data holders initializations --------------- //
+
+// --------------------- Private functions declarations --------------------- //
+
+static void put_link(hwtt_session_t *ses, const char *status);
+static int probe_link(hwtt_session_t *ses);
+static int time_cmd(hwtt_session_t *ses, const char *req, const char *ack,
+        size_t *n_rcv, DWORD *us);
+static int time_rate(hwtt_session_t *ses, const char *req, size_t *n_rcv,
+        DWORD *us);
+static int cmp_rtt(const void *a, const void *b);
+static DWORD get_rate(size_t len, DWORD us, DWORD rtt);
+static void put_probe(hwtt_session_t *ses);
+static void put_rate(hwtt_session_t *ses, const char *field, DWORD rate);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+int open_link(hwtt_session_t *ses) {
+    // Reuse the link opened in a previous execution if it is still alive,
+    // discarding what was received after the last response.
+    if (ses->link_up == TRUE) {
+        write_header(ses->cmd, ses->report, "Communications Link");
+        output(ses->cmd, ses->report, " -> Checking the open link .... ");
+        int ret = check_coms(ses);
+        if (ret == 0) {
+            ret = drop_ring(ses);
+        }
+        if (ret == 0) {
+            output(ses->cmd, ses->report, ok_msg);
+            output(ses->cmd, ses->report, "\n");
+            put_link(ses, "Reused");
+            put_probe(ses);
+
+            return 0;
+        }
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        close_link(ses);
+    }
+
+    // Otherwise, open a new link and start draining it.
+    int ret = init_coms(ses);
+    if (ret != 0) {
+        return 1;
+    }
+    ses->link_up = TRUE;
+    ret = init_reader(ses);
+    if (ret != 0) {
+        print_error(ses, "The reader thread could not be started.");
+        close_link(ses);
+
+        return 1;
+    }
+    ret = probe_link(ses);
+    if (ret == 0) {
+        ret = neg_frames(ses);
+    }
+    if (ret != 0) {
+        close_link(ses);
+
+        return 1;
+    }
+    put_link(ses, "Opened");
+    put_probe(ses);
+
+    // Reject the link if it is slower than the limits of the probe (a
+    // throughput that the PCBA could not measure is not checked).
+    const link_probe_t *p = &ses->probe;
+    int slow = (PROBE_MAX_RTT_US > 0 && p->rtt_p95 > PROBE_MAX_RTT_US);
+    if (PROBE_MIN_RATE > 0) {
+        slow |= (p->up_rate > 0 && (LONGLONG)p->up_rate < PROBE_MIN_RATE);
+        slow |= (p->dn_rate > 0 && (LONGLONG)p->dn_rate < PROBE_MIN_RATE);
+    }
+    if (p->done == TRUE && slow != 0) {
+        print_error(ses, "The link is slower than the limits of the probe.");
+        close_link(ses);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+int time_down(hwtt_session_t *ses, DWORD size, DWORD rtt, DWORD *rate) {
+    // Request the filler, which the PCBA sends before PROBE_OK_HWTT_TEST_END.
+    char   req[DEF_SMA_BUF_SIZE] = {0};
+    size_t n_rcv = 0;
+    DWORD  us    = 0;
+    *rate = 0;
+    sprintf(req, "%s%lu\r", PROBE_DN_CMD, size);
+    int ret = time_rate(ses, req, &n_rcv, &us);
+    if (ret != 0) {
+        return 1;
+    }
+    if (n_rcv > 0) {
+        *rate = get_rate(n_rcv, us, rtt);
+    }
+
+    return 0;
+}
+
+int close_link(hwtt_session_t *ses) {
+    // Close the link, if it is open.
+    if (ses->link_up == FALSE) {
+        return 0;
+    }
+    ses->link_up = FALSE;
+    shut_reader(ses);
+    int ret = shut_coms(ses);
+    if (ret != 0) {
+        return 1;
+    }
+
+    return 0;
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+static void put_link(hwtt_session_t *ses, const char *status) {
+    // Print whether the link was reused or freshly opened, and its target.
+    char msg[DEF_MED_BUF_SIZE] = {0};
+    if (*ses->port != 0) {
+        sprintf(msg, " -> Link %s : %s:%s", status, ses->addr, ses->port);
+    } else if (*ses->baud != 0) {
+        sprintf(msg, " -> Link %s : %s, %s bauds, 8%s%s", status, ses->addr,
+                ses->baud, ses->parity, ses->stop);
+    } else {
+        sprintf(msg, " -> Link %s : %s", status, ses->addr);
+    }
+    output(ses->cmd, ses->report, "\n");
+    output(ses->cmd, ses->report, msg);
+    output(ses->cmd, ses->report, "\n");
+}
+
+static int probe_link(hwtt_session_t *ses) {
+    // Skip the probe if it is not configured.
+    link_probe_t *p = &ses->probe;
+    memset(p, 0, sizeof(link_probe_t));
+    if (PROBE_ECHOES == 0) {
+        return 0;
+    }
+    output(ses->cmd, ses->report, " -> Probing link .............. ");
+
+    // Time the round trips of simple \r requests and sort them to take the
+    // percentiles.
+    DWORD  rtt[PROBE_N_RTT] = {0};
+    size_t n_rcv = 0;
+    int ret = 0;
+    for (int i = 0; i < PROBE_ECHOES && ret == 0; i++) {
+        ret = time_cmd(ses, "\r", "", &n_rcv, &rtt[i]);
+    }
+    if (ret == 0) {
+        qsort(rtt, PROBE_ECHOES, sizeof(DWORD), cmp_rtt);
+        p->rtt_p50 = rtt[(PROBE_ECHOES - 1) * PROBE_P50 / PERCENT];
+        p->rtt_p95 = rtt[(PROBE_ECHOES - 1) * PROBE_P95 / PERCENT];
+        p->rtt_max = rtt[PROBE_ECHOES - 1];
+    }
+
+    // Time the throughput to the PCBA with a request carrying PROBE_SIZE bytes
+    // of filler, which it acknowledges with PROBE_OK_HWTT_TEST_END (any other
+    // response, or none, means that it does not support it).
+    char   req[PROBE_SIZE + DEF_SMA_BUF_SIZE] = {0};
+    size_t len = strlen(PROBE_UP_CMD);
+    DWORD  us  = 0;
+    memcpy(req, PROBE_UP_CMD, len);
+    for (int i = 0; i < PROBE_SIZE; i++) {
+        req[len] = '0' + i % 10;
+        len++;
+    }
+    req[len] = '\r';
+    if (ret == 0) {
+        ret = time_rate(ses, req, &n_rcv, &us);
+    }
+    if (ret == 0 && n_rcv > 0) {
+        p->up_rate = get_rate(len + SINGLE_CHAR_SIZE, us, p->rtt_p50);
+    }
+
+    // Time the throughput from the PCBA with a request of PROBE_SIZE bytes of
+    // filler.
+    if (ret == 0) {
+        ret = time_down(ses, PROBE_SIZE, p->rtt_p50, &p->dn_rate);
+    }
+    if (ret != 0) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
+
+        return 1;
+    }
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
+    p->done = TRUE;
+
+    return 0;
+}
+
+static int time_cmd(hwtt_session_t *ses, const char *req, const char *ack,
+        size_t *n_rcv, DWORD *us) {
+    // Execute the command, timing it from the sending to the arrival of the
+    // last byte of the response. The number of received bytes is 0 if the
+    // PCBA did not acknowledge the command.
+    LARGE_INTEGER freq = {0};
+    LARGE_INTEGER beg  = {0};
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&beg);
+    int acked = FALSE;
+    int ret = exe_cmd(ses, req, ack, &acked, n_rcv);
+    if (ret != 0) {
+        return ret;
+    }
+    if (acked == FALSE) {
+        *n_rcv = 0;
+    }
+    LONGLONG t = (ses->rx_stamp - beg.QuadPart) * US_IN_ONE_S / freq.QuadPart;
+    *us = (t > 0) ? (DWORD)t : 1;
+
+    return 0;
+}
+
+static int time_rate(hwtt_session_t *ses, const char *req, size_t *n_rcv,
+        DWORD *us) {
+    // Time a throughput command. A PCBA that does not know it may not answer
+    // at all (as it waits for the end of an unknown request), so a timeout
+    // means that it is not supported, and what it sends late is discarded.
+    int ret = time_cmd(ses, req, PROBE_ACK, n_rcv, us);
+    if (ret == COMS_TIMEOUT) {
+        *n_rcv = 0;
+        ret = drop_ring(ses);
+    }
+    if (ret != 0) {
+        return 1;
+    }
+
+    return 0;
+}
+
+static int cmp_rtt(const void *a, const void *b) {
+    // Compare two round trip times, in ascending order.
+    DWORD x = *(const DWORD *)a;
+    DWORD y = *(const DWORD *)b;
+
+    return (x > y) - (x < y);
+}
+
+static DWORD get_rate(size_t len, DWORD us, DWORD rtt) {
+    // Get the throughput of a transfer, discounting the median round trip of a
+    // simple request.
+    LONGLONG t = (us > rtt) ? (LONGLONG)(us - rtt) : 1;
+
+    return (DWORD)((LONGLONG)len * US_IN_ONE_S / t);
+}
+
+static void put_probe(hwtt_session_t *ses) {
+    // Print the results of the probe of the link, if it was probed.
+    const link_probe_t *p = &ses->probe;
+    if (p->done == FALSE) {
+        return;
+    }
+    char msg[DEF_MED_BUF_SIZE] = {0};
+    sprintf(msg, " -> Round trip p50/p95/max .... %lu/%lu/%lu us", p->rtt_p50,
+            p->rtt_p95, p->rtt_max);
+    output(ses->cmd, ses->report, msg);
+    output(ses->cmd, ses->report, "\n");
+    put_rate(ses, " -> Throughput to PCBA ........ ", p->up_rate);
+    put_rate(ses, " -> Throughput from PCBA ...... ", p->dn_rate);
+}
+
+static void put_rate(hwtt_session_t *ses, const char *field, DWORD rate) {
+    // Print a throughput, or that the PCBA does not support its measurement.
+    char msg[DEF_MED_BUF_SIZE] = {0};
+    if (rate > 0) {
+        sprintf(msg, "%s%lu B/s", field, rate);
+    } else {
+        sprintf(msg, "%sNot supported", field);
+    }
+    output(ses->cmd, ses->report, msg);
+    output(ses->cmd, ses->report, "\n");
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32
@@ -24,6 +24,11 @@
 
 #define   EN_US                                                           0x0409
 
+#define   US_IN_ONE_S                                                    1000000
+
+#define   CRC_NIB_BITS                                                         4
+#define   CRC_NIB_MASK                                                       0xF
+
 // -------------------- Private data types declarations --------------------- //
 
 // --------------- Public global data holders initializations --------------- //
@@ -31,16 +36,46 @@
 const char    ok_msg[]= "OK";
 const char error_msg[]= "ERROR";
 
-FILE *report = NULL;
-int all_ok = TRUE;
-long ret = 0;
-
 // -------------- Private global data holders initializations --------------- //
 
+static SRWLOCK console_lock = SRWLOCK_INIT;
+
+static const DWORD crc_nib[] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
 // --------------------- Private functions declarations --------------------- //
 
 // ---------------------- Public functions definitions ---------------------- //
 
+void init_session(hwtt_session_t *ses, FILE *cmd) {
+    // Start from an empty session, with no open files nor communications.
+    memset(ses, 0, sizeof(*ses));
+    ses->cmd    = cmd;
+    ses->h      = INVALID_HANDLE_VALUE;
+    ses->s      = (UINT_PTR)~0;
+    ses->all_ok = TRUE;
+    ses->stat.test = STAT_NO_TEST;
+
+    // Fill the data fields with the predefined ones.
+#if       (ETH == 1)
+    sprintf(ses->addr, "%s", DEF_IPV4_ADDR);
+    sprintf(ses->port, "%s", DEF_TCP_PORT);
+#else  // (ETH == 1)
+    sprintf(ses->addr, "%s", DEF_COM_PORT);
+    sprintf(ses->baud, "%s", DEF_BAUD_RATE);
+    sprintf(ses->parity, "%s", DEF_PARITY);
+    sprintf(ses->stop, "%s", DEF_STOP_BITS);
+#endif // (ETH == 1)
+    sprintf(ses->user, "%s", DEF_USER);
+    sprintf(ses->comp, "%s", DEF_COMP);
+    sprintf(ses->bn,   "%s", DEF_BN);
+    sprintf(ses->sn,   "%s", DEF_SN);
+}
+
 void shift_buf(char *buf, size_t len, char new) {
     // Shift one position to the left every character in a buffer, inserting a
     // new character in the rightmost position and discarding the character in
@@ -51,15 +86,101 @@ void shift_buf(char *buf, size_t len, char new) {
     buf[len - 1] = new;
 }
 
-void print_error(const char *msg) {
+void set_deadline(hwtt_session_t *ses, DWORD ms) {
+    // Set the instant when the communications of the session must end.
+    ses->deadline = GetTickCount64() + ms;
+}
+
+DWORD get_remaining(hwtt_session_t *ses) {
+    // Get the milliseconds left until the deadline, or 0 if it has expired.
+    ULONGLONG now = GetTickCount64();
+    if (now >= ses->deadline) {
+        return 0;
+    }
+
+    return ses->deadline - now;
+}
+
+LONGLONG get_stamp(void) {
+    // Read the performance counter, which is monotonic and consistent across
+    // processors.
+    LARGE_INTEGER now = {0};
+    QueryPerformanceCounter(&now);
+
+    return now.QuadPart;
+}
+
+DWORD get_us(LONGLONG beg, LONGLONG end) {
+    // Convert the difference of the timestamps to microseconds, saturating
+    // after about 71 minutes.
+    if (beg == 0 || end == 0 || end < beg) {
+        return 0;
+    }
+    LARGE_INTEGER freq = {0};
+    QueryPerformanceFrequency(&freq);
+    LONGLONG us = (end - beg) * US_IN_ONE_S / freq.QuadPart;
+    if (us > MAXDWORD) {
+        return MAXDWORD;
+    }
+
+    return (DWORD)us;
+}
+
+DWORD crc32(DWORD crc, const void *buf, size_t len) {
+    // Update the CRC-32 (IEEE 802.3) with a buffer, processing every byte as
+    // two nibbles with a table of 16 entries.
+    const BYTE *ptr = buf;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= ptr[i];
+        crc = (crc >> CRC_NIB_BITS) ^ crc_nib[crc & CRC_NIB_MASK];
+        crc = (crc >> CRC_NIB_BITS) ^ crc_nib[crc & CRC_NIB_MASK];
+    }
+
+    return ~crc;
+}
+
+void lock_console(void) {
+    // Wait until no other session is using the console.
+    AcquireSRWLockExclusive(&console_lock);
+}
+
+void unlock_console(void) {
+    // Show what the session printed and let other sessions use the console.
+    show_frame(stdout);
+    ReleaseSRWLockExclusive(&console_lock);
+}
+
+void kill_program(void) {
+    // Wait until the background writer saves the reports and CSV rows of the
+    // PCBAs already tested, and end the program with failure.
+    shut_writer(NULL);
+    exit(1);
+}
+
+void prompt_error(const char *top, const char *msg) {
+    // Hide the console window.
+    ShowWindow(GetConsoleWindow(), SW_HIDE);
+
+    // Prompt the error message.
+    MessageBoxA(NULL, msg, top, MB_OK | MB_ICONERROR);
+
+    // End the program with failure.
+    kill_program();
+}
+
+void print_error(hwtt_session_t *ses, const char *msg) {
     // Print a custom error message or, if NULL is passed as argument, a Windows
     // error message related with communications is gotten using GetLastError()
-    // for (U)ART or WSAGetLastError() for (E)thernet.
-    output(stdout, NULL, "\n");
-    output(stdout, NULL, " -> ");
+    // for (U)ART or WSAGetLastError() for (E)thernet. Sessions without screen
+    // output print it to the report instead.
+    FILE *cmd = ses->cmd;
+    FILE *txt = (cmd == NULL) ? ses->report : NULL;
+    output(cmd, txt, "\n");
+    output(cmd, txt, " -> ");
     if (msg != NULL) {
-        output(stdout, NULL, msg);
-        output(stdout, NULL, "\n");
+        output(cmd, txt, msg);
+        output(cmd, txt, "\n");
     } else {
         DWORD dwMessageId = 0;
         if (*coms == 'U') {
@@ -69,26 +190,26 @@ void print_error(const char *msg) {
             dwMessageId = WSAGetLastError();
         }
         CHAR lpBuffer[DEF_BIG_BUF_SIZE] = {0};
-        ret = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, NULL, dwMessageId,
-                EN_US, lpBuffer, DEF_BIG_BUF_SIZE, NULL);
+        DWORD ret = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, NULL,
+                dwMessageId, EN_US, lpBuffer, DEF_BIG_BUF_SIZE, NULL);
         if (ret != 0) {
-            output(stdout, NULL, lpBuffer);
+            output(cmd, txt, lpBuffer);
         } else {
             const char error_locale[] =
                     "Could not be retrieved the message string matching to the "
                     "following error code, probably because the english localiz"
                     "ation (United States) is not installed in this system.";
-            output(stdout, NULL, error_locale);
-            output(stdout, NULL, "\n");
-            output(stdout, NULL, "\n");
+            output(cmd, txt, error_locale);
+            output(cmd, txt, "\n");
+            output(cmd, txt, "\n");
             char error_code[DEF_SMA_BUF_SIZE] = {0};
             sprintf(error_code, " -> Windows error code = %lu (0x%lX)",
                     dwMessageId, dwMessageId);
-            output(stdout, NULL, error_code);
-            output(stdout, NULL, "\n");
+            output(cmd, txt, error_code);
+            output(cmd, txt, "\n");
         }
     }
-    output(stdout, NULL, "\n");
+    output(cmd, txt, "\n");
 }
 
 // --------------------- Private functions definitions ---------------------- //
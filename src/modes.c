@@ -19,22 +19,18 @@
 // ------------------------ Private headers includes ------------------------ //
 
 #include  <direct.h>
+#include  <io.h>
 #include  <time.h>
 #include  "public.h"
 
 // ---------------------- Private preprocessor macros ----------------------- //
 
-#define   MIN_USER_LEN                                                         1
-#define   MAX_USER_LEN                                                        27
-#define   MIN_COMP_LEN                                                         1
-#define   MAX_COMP_LEN                                                        27
+#define   N_TESTS_DIGS                                                         2
+#define   N_STATIONS_DIGS                                                      2
 
-#define   MIN_BN_LEN                                                           1
-#define   MAX_BN_LEN                                                          27
-#define   MIN_SN_LEN                                                           1
-#define   MAX_SN_LEN                                                          27
+#define   REPORT_BUF_SIZE                                                  65536
 
-#define   N_TESTS_DIGS                                                         2
+#define   US_IN_ONE_MS                                                      1000
 
 // -------------------- Private data types declarations --------------------- //
 
@@ -43,23 +39,30 @@
 // -------------- Private global data holders initializations --------------- //
 
 static const char folder[] = "reports";
-static const char   temp[] = "incomplete.hwtt";
 
-static FILE *csv = NULL;
+static hwtt_session_t station[MAX_STATIONS] = {0};
+
+static volatile LONG n_temp = 0;
 
 // --------------------- Private functions declarations --------------------- //
 
-static int init_files(int prod);
-static int shut_files(int prod);
-static void get_trace(char *user_dat, char *comp_dat, char *bn_dat,
-        char *sn_dat);
-static void add_csv(const char *user_dat, const char *comp_dat,
-        const char *bn_dat, const char *sn_dat, const struct tm *time_struct,
-        int all_ok);
+static void station_thread(hwtt_session_t *ses);
+static int test_full(hwtt_session_t *ses, int prod);
+
+static int init_files(hwtt_session_t *ses, int prod);
+static int shut_files(hwtt_session_t *ses, int prod, const char *file);
+static void save_report(hwtt_session_t *ses);
+static void end_stat(hwtt_session_t *ses, int ok);
+static void get_trace(hwtt_session_t *ses);
+static void get_row(hwtt_session_t *ses, const struct tm *time_struct,
+        char *row);
 
 // ---------------------- Public functions definitions ---------------------- //
 
-void run_full(int prod) {
+void run_full(hwtt_session_t *ses, int prod) {
+    // Start profiling the run, if the profiler is enabled.
+    init_prof();
+
     // Print the initial header with the build information on the screen.
     char header[DEF_SMA_BUF_SIZE] = {0};
     if (prod == TRUE) {
@@ -67,245 +70,484 @@ void run_full(int prod) {
     } else {
         sprintf(header, "%s", "HWTT Testing Report");
     }
-    write_header(stdout, NULL, header);
-    show_version(stdout, NULL);
+    write_header(ses->cmd, NULL, header);
+    show_version(ses->cmd, NULL);
+
+    // Print the failures of the reports saved in background, if any.
+    show_writer(ses->cmd);
 
     // Create the TXT report and/or create/open the traceability CSV.
-    ret = init_files(prod);
+    prof_mark_t pm = {0};
+    prof_mark(&pm);
+    int ret = init_files(ses, prod);
+    prof_add(&pm, PROF_FILES);
     if (ret != 0) {
+        show_prof(ses->cmd);
+
         return;
     }
 
     // Print the initial header with the build information on the TXT report.
-    write_header(NULL, report, header);
-    show_version(NULL, report);
+    write_header(NULL, ses->report, header);
+    show_version(NULL, ses->report);
 
-    // Initialize the communications.
-    ret = init_coms();
+    // Open the communications, or reuse the ones of the previous board.
+    prof_mark(&pm);
+    ret = open_link(ses);
+    prof_add(&pm, PROF_LINK);
     if (ret != 0) {
-        shut_files(prod);
+        shut_files(ses, prod, NULL);
+        show_prof(ses->cmd);
 
         return;
     }
 
     // Request the traceability information.
-    static char user[MAX_USER_LEN + NULL_TERMIN_SIZE] = DEF_USER;
-    static char comp[MAX_COMP_LEN + NULL_TERMIN_SIZE] = DEF_COMP;
-    static char   bn[  MAX_BN_LEN + NULL_TERMIN_SIZE] = DEF_BN;
-    static char   sn[  MAX_SN_LEN + NULL_TERMIN_SIZE] = DEF_SN;
-    get_trace(user, comp, bn, sn);
+    get_trace(ses);
 
-    // Execute all the tests.
-    for (int i = 0; i < N_TESTS; i++) {
-        ret = exe_test(i);
-        if (ret != 0) {
-            shut_coms();
-            shut_files(prod);
+    // Execute all the tests and save the TXT report, and show the profile of
+    // the run.
+    test_full(ses, prod);
+    show_prof(ses->cmd);
+}
 
-            return;
-        }
-    }
+void run_multi(hwtt_session_t *ses) {
+    // Print the initial header with the build information.
+    const char header[] = "HWTT Multi-Station Production";
+    write_header(ses->cmd, NULL, header);
+    show_version(ses->cmd, NULL);
+
+    // Print the failures of the reports saved in background, if any.
+    show_writer(ses->cmd);
+
+    // Request the number of stations.
+    write_header(ses->cmd, NULL, "Stations Setup");
+    const  char n_st_fie[] = " <- Number of stations        : ";
+    static char n_st_dat[N_STATIONS_DIGS + NULL_TERMIN_SIZE] = {0};
+    size_t      n_st_len = strlen(n_st_dat);
+    input(ses->cmd, NULL, n_st_fie, n_st_dat, n_st_len, 1, N_STATIONS_DIGS,
+            numbers);
+    int n_st = atoi(n_st_dat);
+    if (n_st < 1 || n_st > MAX_STATIONS) {
+        char msg[DEF_SMA_BUF_SIZE] = {0};
+        sprintf(msg, "Number of stations out of range [1, %i].", MAX_STATIONS);
+        print_error(ses, msg);
 
-    // Print the results.
-    write_header(stdout, report, "Tests Completed");
-    for (int i = 0; i < N_TESTS; i++) {
-        dis_res(i);
+        return;
     }
-    output(stdout, report, "\n");
 
-    // Print the system's time and date.
-    time_t epoch_secs = 0;
-    time(&epoch_secs);
-    char date_long[DEF_SMA_BUF_SIZE] = {0};
-    struct tm *time_struct = localtime(&epoch_secs);
-    strftime(date_long, sizeof(date_long),
-            " -> Time and Date : %A, %B %d, %Y - %H:%M:%S", time_struct);
-    output(stdout, report, date_long);
-    output(stdout, report, "\n");
-
-    // In the production mode, update the traceability CSV with the results of
-    // the tests.
-    if (prod == TRUE) {
-        add_csv(user, comp, bn, sn, time_struct, all_ok);
-        output(stdout, report, "\n");
-        output(stdout, report, " -> Traceability CSV updated.");
-        output(stdout, report, "\n");
-    }
+    // Prepare every station one after another, as it requires the user: its
+    // TXT report, its communications and its traceability information (the
+    // user and the company are shared by all of them).
+    HANDLE hdl[MAX_STATIONS] = {0};
+    int    n_hdl = 0;
+    for (int i = 0; i < n_st; i++) {
+        hwtt_session_t *st = &station[i];
+        if (st->station == 0) {
+            init_session(st, ses->cmd);
+            st->station = i + 1;
+        }
+        st->cmd = ses->cmd;
+        st->file[0] = 0;
+        st->all_ok = TRUE;
+        st->stat.beg = 0;
+        st->stat.end = 0;
+        st->stat.last = TEST_RES_UNKNOWN;
+        sprintf(st->user, "%s", ses->user);
+        sprintf(st->comp, "%s", ses->comp);
+
+        lock_console();
+        char title[DEF_SMA_BUF_SIZE] = {0};
+        sprintf(title, "Station %02i", st->station);
+        write_header(st->cmd, NULL, title);
+        int ret = init_files(st, TRUE);
+        if (ret != 0) {
+            unlock_console();
 
-    // Print an empty line that marks the end of the TXT report.
-    write_header(stdout, report, "");
+            continue;
+        }
+        write_header(NULL, st->report, "HWTT Production Report");
+        show_version(NULL, st->report);
+        ret = open_link(st);
+        if (ret != 0) {
+            shut_files(st, TRUE, NULL);
+            unlock_console();
 
-    // Close all the communications.
-    shut_coms();
+            continue;
+        }
+        get_trace(st);
+        sprintf(ses->user, "%s", st->user);
+        sprintf(ses->comp, "%s", st->comp);
+
+        // Leave the screen to the user prompts and questions, and start
+        // testing this station while the next one is being prepared. If its
+        // thread cannot be created, the station is left out.
+        st->cmd = NULL;
+        hdl[n_hdl] = CreateThread(NULL, 0, (void *)station_thread, st, 0, NULL);
+        if (hdl[n_hdl] == NULL) {
+            st->cmd = ses->cmd;
+            print_error(st, "The thread of the station could not be created.");
+            close_link(st);
+            shut_files(st, TRUE, NULL);
+            unlock_console();
+
+            continue;
+        }
+        n_hdl++;
+        unlock_console();
+    }
 
-    // Close all the opened files.
-    shut_files(prod);
+    // Wait until all the stations finish, redrawing the dashboard with their
+    // status meanwhile (if enabled), and a last time with the final one.
+    write_header(ses->cmd, NULL, "Testing Stations");
+    lock_console();
+    output(ses->cmd, NULL, " -> Waiting for all the stations to finish.");
+    output(ses->cmd, NULL, "\n");
+    unlock_console();
+    if (n_hdl > 0) {
+        DWORD ms = (DASHBOARD_MS > 0) ? DASHBOARD_MS : INFINITE;
+        init_dash();
+        DWORD ret = WAIT_TIMEOUT;
+        while (ret == WAIT_TIMEOUT) {
+            ret = WaitForMultipleObjects(n_hdl, hdl, TRUE, ms);
+            if (ret == WAIT_TIMEOUT) {
+                show_dash(station, n_st);
+            }
+        }
 
-    // Get the new name of the TXT report with the batch number, serial number
-    // and whole result of the tested PCBA.
-    char file[DEF_SMA_BUF_SIZE] = {0};
-           if (prod == FALSE && all_ok == FALSE) {
-        sprintf(file,"_test_%s_%s_ERROR.txt", bn, sn);
-    } else if (prod == FALSE && all_ok ==  TRUE) {
-        sprintf(file,"_test_%s_%s_OK.txt"   , bn, sn);
-    } else if (prod ==  TRUE && all_ok == FALSE) {
-        sprintf(file,      "%s_%s_ERROR.txt", bn, sn);
-    } else {
-        sprintf(file,      "%s_%s_OK.txt"   , bn, sn);
+        // If the wait fails, wait for every station on its own, so that the
+        // stations are never prepared again while some of them are testing.
+        if (ret == WAIT_FAILED) {
+            for (int i = 0; i < n_hdl; i++) {
+                WaitForSingleObject(hdl[i], INFINITE);
+            }
+        }
+        if (DASHBOARD_MS > 0) {
+            show_dash(station, n_st);
+        }
+    }
+    for (int i = 0; i < n_hdl; i++) {
+        CloseHandle(hdl[i]);
     }
 
-    // Set the folder to save the new TXT report.
-    char path[DEF_MED_BUF_SIZE] = {0};
-    sprintf(path, "%s\\%s", folder, file);
-
-    // Insert the new TXT report in the folder, after deleting an old one with
-    // the same name if exists.
-    ret = remove(path);
-    output(stdout, NULL, " -> ");
-    if (ret != 0 && errno == EACCES) {
-        char overwrite_error[DEF_MED_BUF_SIZE] = {0};
-        sprintf(
-                overwrite_error,
-                "Old TXT report exists that could not be replaced. The current "
-                "TXT report was saved as \"%s\". Before continue, delete manual"
-                "ly the old one, rename the new one and move it to the \"report"
-                "s\" folder.",
-                temp
-        );
-        output(stdout, NULL, overwrite_error);
-    } else {
-        rename(temp, path);
-        char save_msg[DEF_MED_BUF_SIZE] = {0};
-        sprintf(save_msg, "Saved as %s", file);
-        output(stdout, NULL, save_msg);
+    // Print a summary with the saved TXT report of every station.
+    write_header(ses->cmd, NULL, "Stations Completed");
+    for (int i = 0; i < n_st; i++) {
+        hwtt_session_t *st = &station[i];
+        char line[DEF_MED_BUF_SIZE] = {0};
+        if (*st->file != 0) {
+            sprintf(line, " -> Station %02i : %s", st->station, st->file);
+        } else {
+            sprintf(line, " -> Station %02i : %s", st->station, error_msg);
+        }
+        output(ses->cmd, NULL, line);
+        output(ses->cmd, NULL, "\n");
+        st->cmd = ses->cmd;
     }
-    output(stdout, NULL, "\n");
-    output(stdout, NULL, "\n");
+    output(ses->cmd, NULL, "\n");
 }
 
-void run_single(void) {
+void run_single(hwtt_session_t *ses) {
     // Print the initial header with the build information.
     const char header[] = "HWTT Single Test";
-    write_header(stdout, NULL, header);
-    show_version(stdout, NULL);
+    write_header(ses->cmd, NULL, header);
+    show_version(ses->cmd, NULL);
 
-    // Initialize the communications.
-    ret = init_coms();
+    // Print the failures of the reports saved in background, if any.
+    show_writer(ses->cmd);
+
+    // Open the communications, or reuse the ones of the previous execution.
+    int ret = open_link(ses);
     if (ret != 0) {
         return;
     }
 
-    // Select and execute the desired tests and shutdown the communications when
-    // finished (or in case of error).
+    // Without TXT report, the bulk data is not saved (only its size and
+    // CRC-32 are shown).
+    ses->side[0] = 0;
+
+    // Select and execute the desired tests, keeping the communications open
+    // when finished (they are closed only in case of error).
     int more = 0;
     do {
-        write_header(stdout, NULL, "Test Selection");
+        write_header(ses->cmd, NULL, "Test Selection");
         const char test_fie[]  = " <- Select test number : ";
         char       test_dat[N_TESTS_DIGS + NULL_TERMIN_SIZE] = {0};
         size_t     test_len = strlen(test_dat);
-        input(stdout, NULL, test_fie, test_dat, test_len, 1, N_TESTS_DIGS,
+        input(ses->cmd, NULL, test_fie, test_dat, test_len, 1, N_TESTS_DIGS,
                 numbers);
         int test_num = atoi(test_dat);
         if (test_num < N_TESTS) {
-            ret = exe_test(test_num);
+            ret = exe_test(ses, test_num);
             if (ret != 0) {
+                close_link(ses);
                 break;
             }
-            write_header(stdout, NULL, "");
-            ask_yes_no(stdout, NULL, " <- Execute more tests? [Y/N] : ", &more);
+            write_header(ses->cmd, NULL, "");
+            ask_yes_no(ses->cmd, NULL, " <- Execute more tests? [Y/N] : ",
+                    &more);
         } else {
-            output(stdout, NULL, "\n");
-            output(stdout, NULL, " -> Test number out of range [0, N_TESTS - 1]"
-                    ".");
-            output(stdout, NULL, "\n");
+            output(ses->cmd, NULL, "\n");
+            output(ses->cmd, NULL, " -> Test number out of range [0, N_TESTS -"
+                    " 1].");
+            output(ses->cmd, NULL, "\n");
         }
     } while (more == YES);
+    output(ses->cmd, NULL, "\n");
+}
 
-    // Close all the communications.
-    shut_coms();
-    output(stdout, NULL, "\n");
+void shut_multi(void) {
+    // Close the links that the stations kept open between executions.
+    for (int i = 0; i < MAX_STATIONS; i++) {
+        close_link(&station[i]);
+    }
 }
 
 // --------------------- Private functions definitions ---------------------- //
 
-static int init_files(int prod) {
+static void station_thread(hwtt_session_t *ses) {
+    // Execute all the tests of a station and save its TXT report.
+    test_full(ses, TRUE);
+}
+
+static int test_full(hwtt_session_t *ses, int prod) {
+    // Save what the TXT report has so far, before the tests start.
+    save_report(ses);
+
+    // Forget the timings of the previous PCBA, and start its status.
+    memset(ses->phase, 0, sizeof(ses->phase));
+    ses->stat.last = TEST_RES_UNKNOWN;
+    ses->stat.end  = 0;
+    ses->stat.beg  = get_stamp();
+
+    // Name the sidecar files of the bulk data after the PCBA, as the TXT
+    // report (they are saved directly in the folder).
+    const char *pre = (prod == TRUE) ? "" : "_test_";
+    sprintf(ses->side, "%s\\%s%s_%s", folder, pre, ses->bn, ses->sn);
+
+    // Execute all the tests, in pipelined batches when possible, saving the
+    // TXT report after the result of each one.
+    for (int i = 0, n = 0; i < N_TESTS; i += n) {
+        int ret = 0;
+        n = get_batch(i);
+        ses->stat.test = i;
+        if (n > 1) {
+            prof_mark_t pm = {0};
+            prof_mark(&pm);
+            ret = exe_batch(ses, i, n);
+            prof_add(&pm, PROF_LINK);
+        } else {
+            n = 1;
+            ret = exe_test(ses, i);
+        }
+        if (ret != 0) {
+            end_stat(ses, FALSE);
+            close_link(ses);
+            char file[DEF_SMA_BUF_SIZE] = {0};
+            const char *pre = (prod == TRUE) ? "" : "_test_";
+            sprintf(file, "%s%s_%s_ABORTED.txt", pre, ses->bn, ses->sn);
+            shut_files(ses, prod, file);
+
+            return 1;
+        }
+        ses->stat.last = ses->result[i + n - 1];
+        save_report(ses);
+    }
+
+    // Print the results.
+    write_header(ses->cmd, ses->report, "Tests Completed");
+    for (int i = 0; i < N_TESTS; i++) {
+        dis_res(ses, i);
+    }
+    output(ses->cmd, ses->report, "\n");
+    end_stat(ses, ses->all_ok);
+
+    // Print the system's time and date.
+    time_t epoch_secs = 0;
+    time(&epoch_secs);
+    char date_long[DEF_SMA_BUF_SIZE] = {0};
+    struct tm *time_struct = localtime(&epoch_secs);
+    strftime(date_long, sizeof(date_long),
+            " -> Time and Date : %A, %B %d, %Y - %H:%M:%S", time_struct);
+    output(ses->cmd, ses->report, date_long);
+    output(ses->cmd, ses->report, "\n");
+
+    // In the production mode, prepare the row of the traceability CSV with the
+    // results of the tests.
+    write_job_t job = {0};
+    if (prod == TRUE) {
+        get_row(ses, time_struct, job.row);
+        output(ses->cmd, NULL, "\n");
+        output(ses->cmd, NULL, " -> Traceability CSV update queued.");
+        output(ses->cmd, NULL, "\n");
+    }
+
+    // Print an empty line that marks the end of the results.
+    write_header(ses->cmd, NULL, "");
+
+    // Get the new name of the TXT report with the batch number, serial number
+    // and whole result of the tested PCBA.
+    char file[DEF_SMA_BUF_SIZE] = {0};
+    const char *bn = ses->bn;
+    const char *sn = ses->sn;
+           if (prod == FALSE && ses->all_ok == FALSE) {
+        sprintf(file,"_test_%s_%s_ERROR.txt", bn, sn);
+    } else if (prod == FALSE && ses->all_ok ==  TRUE) {
+        sprintf(file,"_test_%s_%s_OK.txt"   , bn, sn);
+    } else if (prod ==  TRUE && ses->all_ok == FALSE) {
+        sprintf(file,      "%s_%s_ERROR.txt", bn, sn);
+    } else {
+        sprintf(file,      "%s_%s_OK.txt"   , bn, sn);
+    }
+
+    // Hand the files over to the background writer, which appends the row to
+    // the traceability CSV, ends the TXT report and moves it to the folder, so
+    // that the next PCBA can be tested right away. Its failures are shown on
+    // the next screen.
+    job.report = ses->report;
+    job.csv    = ses->csv;
+    sprintf(job.temp, "%s", ses->temp);
+    sprintf(job.path, "%s\\%s", folder, file);
+    ses->report = NULL;
+    ses->csv    = NULL;
+    prof_mark_t pm = {0};
+    prof_mark(&pm);
+    push_writer(&job);
+    prof_add(&pm, PROF_FILES);
+    char save_msg[DEF_MED_BUF_SIZE] = {0};
+    sprintf(save_msg, " -> Saving as %s", file);
+    output(ses->cmd, NULL, save_msg);
+    sprintf(ses->file, "%s", file);
+    output(ses->cmd, NULL, "\n");
+    output(ses->cmd, NULL, "\n");
+
+    return 0;
+}
+
+static int init_files(hwtt_session_t *ses, int prod) {
     // Print an initial header.
-    write_header(stdout, NULL, "Files Setup");
+    write_header(ses->cmd, NULL, "Files Setup");
 
     // Create and/or open the folder where the TXT reports generated after
     // performing the tests are going to be saved.
-    output(stdout, NULL, " -> Opening reports folder .... ");
-    ret = _mkdir(folder);
+    output(ses->cmd, NULL, " -> Opening reports folder .... ");
+    int ret = _mkdir(folder);
     if (ret != 0 && errno != EEXIST) {
-        output(stdout, NULL, error_msg);
-        output(stdout, NULL, "\n");
-        print_error("The complete TXT reports folder could not be accessed.");
+        output(ses->cmd, NULL, error_msg);
+        output(ses->cmd, NULL, "\n");
+        print_error(ses, "The complete TXT reports folder could not be accesse"
+                "d.");
 
         return 1;
     }
-    output(stdout, NULL, ok_msg);
-    output(stdout, NULL, "\n");
-
-    // Create the (temporal) TXT report file. If it already exists, it is
-    // deleted and created again.
-    output(stdout, NULL, " -> Opening the report file ... ");
-    report = fopen(temp, "wb+");
-    if (report == NULL) {
-        output(stdout, NULL, error_msg);
-        output(stdout, NULL, "\n");
-        print_error("The temporal report file could not be accessed.");
+    output(ses->cmd, NULL, ok_msg);
+    output(ses->cmd, NULL, "\n");
+
+    // Create the (temporal) TXT report file, with a name that is not used by
+    // the reports still being saved in background. If it already exists, it
+    // is deleted and created again.
+    output(ses->cmd, NULL, " -> Opening the report file ... ");
+    sprintf(ses->temp, "incomplete_%02i_%04li.hwtt", ses->station,
+            InterlockedIncrement(&n_temp));
+    ses->report = fopen(ses->temp, "wb+");
+    if (ses->report == NULL) {
+        output(ses->cmd, NULL, error_msg);
+        output(ses->cmd, NULL, "\n");
+        print_error(ses, "The temporal report file could not be accessed.");
 
         return 1;
     }
-    setvbuf(report, NULL, _IONBF, 0);
-    output(stdout, NULL, ok_msg);
+    setvbuf(ses->report, NULL, _IOFBF, REPORT_BUF_SIZE);
+    output(ses->cmd, NULL, ok_msg);
 
     // In the production mode, open the CSV file (creating it if needed).
     if (prod == TRUE) {
-        output(stdout, NULL, "\n");
-        output(stdout, NULL, " -> Opening the CSV file ...... ");
+        output(ses->cmd, NULL, "\n");
+        output(ses->cmd, NULL, " -> Opening the CSV file ...... ");
         char buf[DEF_SMA_BUF_SIZE] = {0};
-        sprintf(buf, "%s.csv", PCBA_VERSION);
-        csv = fopen(buf, "ab+");
-        if (csv == NULL) {
-            output(stdout, NULL, error_msg);
-            output(stdout, NULL, "\n");
-            print_error("The traceability CSV file could not be accessed.");
-            fclose(report);
+        get_csv_name(buf, "csv");
+        DWORD dwDesiredAccess = GENERIC_READ | FILE_APPEND_DATA;
+        DWORD dwShareMode     = FILE_SHARE_READ | FILE_SHARE_WRITE;
+        ses->csv = CreateFileA(buf, dwDesiredAccess, dwShareMode, NULL,
+                OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (ses->csv == INVALID_HANDLE_VALUE) {
+            ses->csv = NULL;
+            output(ses->cmd, NULL, error_msg);
+            output(ses->cmd, NULL, "\n");
+            print_error(ses, "The traceability CSV file could not be accessed"
+                    ".");
+            fclose(ses->report);
+            ses->report = NULL;
 
             return 1;
         }
-        setvbuf(csv, NULL, _IONBF, 0);
-        output(stdout, NULL, ok_msg);
+        output(ses->cmd, NULL, ok_msg);
     }
 
     return 0;
 }
 
-static int shut_files(int prod) {
-    // In the production mode, close the traceability CSV file.
-    if (prod == TRUE) {
-        ret = fclose(csv);
-        if (ret != 0) {
-            fclose(report);
-
-            return 1;
-        }
+static int shut_files(hwtt_session_t *ses, int prod, const char *file) {
+    // In the production mode, close the traceability CSV file, and close the
+    // TXT report file.
+    int err = 0;
+    if (prod == TRUE && CloseHandle(ses->csv) == FALSE) {
+        err = 1;
     }
+    ses->csv = NULL;
+    if (fclose(ses->report) != 0) {
+        err = 1;
+    }
+    ses->report = NULL;
 
-    // Close the TXT report file.
-    ret = fclose(report);
-    if (ret != 0) {
+    // Move the TXT report of a PCBA whose tests were aborted to the folder,
+    // with the given name (replacing an old one), or delete it if no PCBA was
+    // tested, so that no temporal file is left behind.
+    if (file == NULL) {
+        remove(ses->temp);
+
+        return err;
+    }
+    char path[DEF_MED_BUF_SIZE] = {0};
+    sprintf(path, "%s\\%s", folder, file);
+    remove(path);
+    if (rename(ses->temp, path) != 0) {
         return 1;
     }
 
-    return 0;
+    return err;
+}
+
+static void save_report(hwtt_session_t *ses) {
+    // Write the buffered TXT report to its file and make the operating system
+    // commit it to the disk, as a checkpoint that survives a crash.
+    prof_mark_t pm = {0};
+    prof_mark(&pm);
+    fflush(ses->report);
+    _commit(_fileno(ses->report));
+    prof_add(&pm, PROF_FILES);
+}
+
+static void end_stat(hwtt_session_t *ses, int ok) {
+    // End the status of the PCBA, counting it as passed or as failed (also if
+    // its tests could not be finished).
+    ses->stat.end  = get_stamp();
+    ses->stat.test = STAT_NO_TEST;
+    if (ok == TRUE) {
+        InterlockedIncrement(&ses->stat.n_pass);
+    } else {
+        InterlockedIncrement(&ses->stat.n_fail);
+    }
 }
 
-static void get_trace(char *user_dat, char *comp_dat, char *bn_dat,
-        char *sn_dat) {
+static void get_trace(hwtt_session_t *ses) {
+    char *user_dat = ses->user;
+    char *comp_dat = ses->comp;
+    char   *bn_dat = ses->bn;
+    char   *sn_dat = ses->sn;
+
     // Print an initial header.
-    write_header(stdout, report, "Traceability Information");
+    write_header(ses->cmd, ses->report, "Traceability Information");
 
     // Request the identification of the user who performs the tests. It is
     // saved so that it is not requested again if more PCBAs are tested during
@@ -313,12 +555,12 @@ static void get_trace(char *user_dat, char *comp_dat, char *bn_dat,
     const char user_fie[] = " <- User identification       : ";
     size_t     user_len = strlen(user_dat);
     if (user_len == 0) {
-        input(stdout, report, user_fie, user_dat, user_len, MIN_USER_LEN,
+        input(ses->cmd, ses->report, user_fie, user_dat, user_len, MIN_USER_LEN,
                 MAX_USER_LEN, all);
     } else {
-        output(stdout, report, user_fie);
-        output(stdout, report, user_dat);
-        output(stdout, report, "\n");
+        output(ses->cmd, ses->report, user_fie);
+        output(ses->cmd, ses->report, user_dat);
+        output(ses->cmd, ses->report, "\n");
     }
 
     // Request the identification of the company that performs the tests. It is
@@ -327,69 +569,72 @@ static void get_trace(char *user_dat, char *comp_dat, char *bn_dat,
     const char comp_fie[] = " <- Company identification    : ";
     size_t     comp_len = strlen(comp_dat);
     if (comp_len == 0) {
-        input(stdout, report, comp_fie, comp_dat, comp_len, MIN_COMP_LEN,
+        input(ses->cmd, ses->report, comp_fie, comp_dat, comp_len, MIN_COMP_LEN,
                 MAX_COMP_LEN, all);
     } else {
-        output(stdout, report, comp_fie);
-        output(stdout, report, comp_dat);
-        output(stdout, report, "\n");
+        output(ses->cmd, ses->report, comp_fie);
+        output(ses->cmd, ses->report, comp_dat);
+        output(ses->cmd, ses->report, "\n");
     }
-    output(stdout, report, "\n");
+    output(ses->cmd, ses->report, "\n");
 
     // Request the batch number of the PCBA to be tested.
     const char   bn_fie[] = " <- PCBA batch number         : ";
     size_t       bn_len = strlen(bn_dat);
-    input(stdout, report, bn_fie, bn_dat, bn_len, MIN_BN_LEN, MAX_BN_LEN,
+    input(ses->cmd, ses->report, bn_fie, bn_dat, bn_len, MIN_BN_LEN, MAX_BN_LEN,
             numbers);
 
     // Request the serial number of the PCBA to be tested.
     const char   sn_fie[] = " <- PCBA serial number        : ";
     size_t       sn_len = strlen(sn_dat);
-    input(stdout, report, sn_fie, sn_dat, sn_len, MIN_SN_LEN, MAX_SN_LEN,
+    input(ses->cmd, ses->report, sn_fie, sn_dat, sn_len, MIN_SN_LEN, MAX_SN_LEN,
             numbers);
-}
 
-static void add_csv(const char *user_dat, const char *comp_dat,
-        const char *bn_dat, const char *sn_dat, const struct tm *time_struct,
-        int all_ok) {
-    // If the traceability CSV is empty, add a header with the title of each
-    // column.
-    fseek(csv, 0, SEEK_END);
-    ret = ftell(csv);
-    if (ret == 0) {
-        fprintf(csv, "\"USER\";\"COMP\";\"B/N\";\"S/N\";\"Time_Date\";\"OK?\"");
-        fprintf(csv, "\n");
+    // In the production mode, show the history of the PCBA from the index of
+    // the traceability CSV before testing it.
+    if (ses->csv != NULL) {
+        const char hist_fie[] = " -> Previously tested         : ";
+        char       hist_dat[DEF_MED_BUF_SIZE] = {0};
+        trace_rec_t rec = {0};
+        int ret = find_trace(bn_dat, sn_dat, &rec);
+        if (ret != 0) {
+            sprintf(hist_dat, "%s", "Unknown (index not available)");
+        } else if (rec.n_runs == 0) {
+            sprintf(hist_dat, "%s", "Never");
+        } else {
+            sprintf(hist_dat, "%lu times, last OK? %s at %s", rec.n_runs,
+                    rec.ok, rec.date);
+        }
+        output(ses->cmd, ses->report, "\n");
+        output(ses->cmd, ses->report, hist_fie);
+        output(ses->cmd, ses->report, hist_dat);
+        output(ses->cmd, ses->report, "\n");
     }
+}
 
-    // Insert in the traceability CSV the user's identification.
-    fprintf(csv, "\"%s\"", user_dat);
-    fprintf(csv, ";");
-
-    // Insert in the traceability CSV the company's identification.
-    fprintf(csv, "\"%s\"", comp_dat);
-    fprintf(csv, ";");
-
-    // Insert in the traceability CSV the batch number of the tested PCBA.
-    fprintf(csv, "\"%s\"", bn_dat);
-    fprintf(csv, ";");
-
-    // Insert in the traceability CSV the serial number of the tested PCBA.
-    fprintf(csv, "\"%s\"", sn_dat);
-    fprintf(csv, ";");
-
-    // Insert in the traceability CSV the current time and date.
+static void get_row(hwtt_session_t *ses, const struct tm *time_struct,
+        char *row) {
+    // Get the row of the traceability CSV with the user's identification, the
+    // company's identification, the batch number and serial number of the
+    // tested PCBA, the current time and date, and the whole result of the
+    // tests.
     char date_short[DEF_SMA_BUF_SIZE] = {0};
     strftime(date_short, sizeof(date_short), "%Y_%m_%d_%H_%M_%S", time_struct);
-    fprintf(csv, "\"%s\"", date_short);
-    fprintf(csv, ";");
+    const char *ok = (ses->all_ok == TRUE) ? "Yes" : "No";
+    int len = sprintf(row, "\"%s\";\"%s\";\"%s\";\"%s\";\"%s\";\"%s\"",
+            ses->user, ses->comp, ses->bn, ses->sn, date_short, ok);
 
-    // Insert in the traceability CSV the whole result of the tests.
-    if (all_ok == TRUE) {
-        fprintf(csv, "\"Yes\"");
-    } else {
-        fprintf(csv, "\"No\"");
+    // Add the duration of every test, in milliseconds.
+    for (int i = 0; i < N_TESTS; i++) {
+        const test_time_t *t = &ses->phase[i];
+        len += sprintf(&row[len], ";\"%lu\"",
+                get_us(t->beg, t->end) / US_IN_ONE_MS);
     }
-    fprintf(csv, "\n");
+
+    // End it with the CRC-32 of the previous columns, so that a torn row can be
+    // detected.
+    DWORD crc = crc32(0, row, len);
+    sprintf(&row[len], ";\"%08lX\"\n", crc);
 }
 
 // -----------------------------------------------------------------------------
@@ -0,0 +1,167 @@
+// -----------------------------------------------------------------------------
+// PROFILE_C
+//
+// - Cycle time profiler, which splits the wall time of every full run into
+//   operator input, link I/O, file I/O and console output, and keeps the totals
+//   of the whole session in a profile log
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  <time.h>
+#include  "public.h"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   MS_IN_ONE_S                                                       1000
+#define   PERCENT                                                            100
+
+// -------------------- Private data types declarations --------------------- //
+
+// --------------- Public global data holders initializations --------------- //
+
+// -------------- Private global data holders initializations --------------- //
+
+static const char *const bucket_name[PROF_N_BUCKETS] = {
+    "Operator input",
+    "Link I/O",
+    "File I/O",
+    "Console output"
+};
+
+static _Thread_local LONGLONG bucket[PROF_N_BUCKETS] = {0};
+static _Thread_local LONGLONG acct    = 0;
+static _Thread_local LONGLONG run_beg = 0;
+
+static LONGLONG total[PROF_N_BUCKETS] = {0};
+static LONGLONG total_wall = 0;
+static DWORD    n_runs     = 0;
+
+// --------------------- Private functions declarations --------------------- //
+
+static void put_row(FILE *cmd, FILE *log, const char *name, LONGLONG run,
+        LONGLONG wall, LONGLONG ses);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+void init_prof(void) {
+    // Start from empty buckets, as the profile is per run.
+    if (PROFILE == 0) {
+        return;
+    }
+    memset(bucket, 0, sizeof(bucket));
+    acct    = 0;
+    run_beg = get_stamp();
+}
+
+void prof_mark(prof_mark_t *m) {
+    // Note the current time and the time already accounted, outside the runs
+    // only if the profiler is enabled.
+    m->beg  = 0;
+    m->acct = 0;
+    if (PROFILE == 0 || run_beg == 0) {
+        return;
+    }
+    m->beg  = get_stamp();
+    m->acct = acct;
+}
+
+void prof_add(const prof_mark_t *m, prof_bucket_t b) {
+    // Account the time of the section, minus the one accounted meanwhile by
+    // the nested sections.
+    if (m->beg == 0) {
+        return;
+    }
+    LONGLONG own = get_stamp() - m->beg - (acct - m->acct);
+    bucket[b] += own;
+    acct      += own;
+}
+
+void show_prof(FILE *cmd) {
+    // End the run and add it to the totals of the session.
+    if (PROFILE == 0 || run_beg == 0) {
+        return;
+    }
+    LONGLONG wall = get_stamp() - run_beg;
+    run_beg = 0;
+    n_runs++;
+    total_wall += wall;
+    LONGLONG total_acct = 0;
+    for (int i = 0; i < PROF_N_BUCKETS; i++) {
+        total[i]   += bucket[i];
+        total_acct += total[i];
+    }
+
+    // Append the profile to the log, next to the traceability CSV, with the
+    // time and date of the end of the run (it is only printed on the screen if
+    // the log cannot be opened).
+    char name[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(name, "%s_profile.log", PCBA_VERSION);
+    FILE *log = fopen(name, "ab");
+    if (log != NULL) {
+        time_t epoch_secs = 0;
+        time(&epoch_secs);
+        char date[DEF_SMA_BUF_SIZE] = {0};
+        strftime(date, sizeof(date), " -> Run ended : %Y_%m_%d_%H_%M_%S",
+                localtime(&epoch_secs));
+        output(NULL, log, date);
+        output(NULL, log, "\n");
+    }
+
+    // Print every bucket for the run and for the session, with the share of
+    // the run, and the rest of the time (computing).
+    write_header(cmd, log, "Cycle Time Profile");
+    char msg[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(msg, " -> Runs in this session : %lu", n_runs);
+    output(cmd, log, msg);
+    output(cmd, log, "\n");
+    output(cmd, log, "\n");
+    output(cmd, log, " -> Bucket          Run (ms)      %   Session (ms)");
+    output(cmd, log, "\n");
+    for (int i = 0; i < PROF_N_BUCKETS; i++) {
+        put_row(cmd, log, bucket_name[i], bucket[i], wall, total[i]);
+    }
+    put_row(cmd, log, "Other", wall - acct, wall, total_wall - total_acct);
+    put_row(cmd, log, "Total", wall, wall, total_wall);
+    if (log != NULL) {
+        output(NULL, log, "\n");
+        fclose(log);
+    } else {
+        output(cmd, NULL, "\n");
+        output(cmd, NULL, " -> Profile log not updated!");
+        output(cmd, NULL, "\n");
+    }
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+static void put_row(FILE *cmd, FILE *log, const char *name, LONGLONG run,
+        LONGLONG wall, LONGLONG ses) {
+    // Print a bucket of the profile, converting the counts of the performance
+    // counter to milliseconds.
+    LARGE_INTEGER freq = {0};
+    QueryPerformanceFrequency(&freq);
+    double share = (wall > 0) ? (double)run * PERCENT / wall : 0;
+    char msg[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(msg, " -> %-14s %9lli %6.1f %14lli", name,
+            run * MS_IN_ONE_S / freq.QuadPart, share,
+            ses * MS_IN_ONE_S / freq.QuadPart);
+    output(cmd, log, msg);
+    output(cmd, log, "\n");
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32
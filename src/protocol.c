@@ -18,202 +18,1324 @@
 
 // ------------------------ Private headers includes ------------------------ //
 
+#include  <ctype.h>
 #include  "public.h"
 
 // ---------------------- Private preprocessor macros ----------------------- //
 
+#define   FRAME_CMD                                               "HWTT_F_BIN\r"
+#define   FRAME_ACK                                                   "FRAME_OK"
+
+#define   FRAME_MAGIC_0                                                      'H'
+#define   FRAME_MAGIC_1                                                      'B'
+#define   FRAME_NUM_POS                                                        2
+#define   FRAME_EC_POS                                                         3
+#define   FRAME_LEN_POS                                                        4
+#define   FRAME_HDR_SIZE                                                       8
+#define   FRAME_CRC_SIZE                                                       4
+#define   FRAME_MAX_LEN                                                 16777216
+
+#define   BULK_BUF_SIZE                                                  1048576
+
+#define   DL_MAX_RETRIES                                                       5
+#define   DL_REQ_SIZE                     (DL_CHUNK_SIZE * 2 + DEF_SMA_BUF_SIZE)
+
+#define   US_IN_ONE_S                                                    1000000
+#define   US_IN_ONE_MS                                                      1000
+
+#define   PRINTABLE_MIN                                                      ' '
+#define   PRINTABLE_MAX                                                      '~'
+
+#define   TERM_WIN_SIZE                                                       32
+#define   TERM_WIN_MASK                                      (TERM_WIN_SIZE - 1)
+#define   TERM_XX_LEN                                                          3
+#define   TERM_EC_LEN                                                          1
+#define   TERM_TAIL_LEN               (sizeof(HWTT_TEST_END) - NULL_TERMIN_SIZE)
+#define   TERM_LEN                   (TERM_EC_LEN + TERM_XX_LEN + TERM_TAIL_LEN)
+
 // -------------------- Private data types declarations --------------------- //
 
-typedef enum test_res {
-    TEST_RES_UNKNOWN  = 0,
-    TEST_RES_QUESTION = 1,
-    TEST_RES_FAIL     = 2,
-    TEST_RES_PASS     = 3
-} test_res_t;
+// -----------------------------------------------------------------------------
+// Streaming matcher of the _XX_HWTT_TEST_END sequence: a KMP automaton runs
+// over the fixed _HWTT_TEST_END tail and, when it completes, the window of the
+// last consumed bytes is checked for the <EC>_<XX> prefix
+// -----------------------------------------------------------------------------
+typedef struct term_match {
+    const char *want;                    // Flags of the awaited tests
+    int    num;                          // Number of the test, when finished
+    size_t state;                        // Matched length of the tail
+    size_t n_con;                        // Number of consumed bytes
+    size_t fail[sizeof(HWTT_TEST_END)];  // KMP failure function of the tail
+    char   win[TERM_WIN_SIZE];           // Last consumed bytes
+    char   ec;                           // Error code, valid when finished
+} term_match_t;
+
+// -----------------------------------------------------------------------------
+// Sink of the bulk data of a response: its sidecar file (none in the single
+// test mode), with the size and the CRC-32 of the data. The last received bytes
+// are held back until it is known that they are not part of the end sequence
+// -----------------------------------------------------------------------------
+typedef struct bulk_sink {
+    FILE  *f;                            // Sidecar file or NULL
+    char   name[DEF_MED_BUF_SIZE];       // Sidecar file path
+    size_t size;                         // Size of the saved data
+    DWORD  crc;                          // CRC-32 of the saved data
+    size_t keep;                         // Number of bytes to hold back
+    size_t n_hold;                       // Number of held back bytes
+    char   hold[TERM_LEN];               // Held back bytes
+} bulk_sink_t;
 
 // --------------- Public global data holders initializations --------------- //
 
 // -------------- Private global data holders initializations --------------- //
 
-static test_res_t result[N_TESTS] = {0};
-
 // --------------------- Private functions declarations --------------------- //
 
-static int tx_req(int num);
-static int rx_res(int num);
+static int tx_req(hwtt_session_t *ses, int num);
+static int exe_dl(hwtt_session_t *ses, int num);
+static int tx_chunk(hwtt_session_t *ses, int num, FILE *f, DWORD seq,
+        const char **err);
+static int rx_ack(hwtt_session_t *ses, int num, DWORD *ack, char *ec,
+        const char **err);
+static int rx_res(hwtt_session_t *ses, int num);
+static int rx_next(hwtt_session_t *ses, term_match_t *m, const char **buf,
+        size_t *len);
+static int rx_bin(hwtt_session_t *ses, int num);
+static int rx_frame(hwtt_session_t *ses, const char *want, int *num, char *ec,
+        char **pay, size_t *len, bulk_sink_t *sink, const char **err);
+static int recv_all(hwtt_session_t *ses, void *buf, size_t len);
+static int recv_bulk(hwtt_session_t *ses, bulk_sink_t *sink, size_t len,
+        DWORD *crc);
+static DWORD get_le32(const unsigned char *buf);
+
+static void put_req_head(hwtt_session_t *ses);
+static void put_req_tail(hwtt_session_t *ses, int num);
+static void put_res_head(hwtt_session_t *ses);
+static void put_res_tail(hwtt_session_t *ses);
+static void put_failed(hwtt_session_t *ses);
+static void put_res(hwtt_session_t *ses, const char *buf, size_t len);
+static void put_bulk(hwtt_session_t *ses, bulk_sink_t *sink);
+static int put_timeout(hwtt_session_t *ses, int num);
+static void put_time(hwtt_session_t *ses, int num);
+static test_res_t get_res(char ec);
+static DWORD get_timeout(int num);
+
+static FILE *get_operator(hwtt_session_t *ses, int num);
+static void put_operator(hwtt_session_t *ses);
+
+static void init_match(term_match_t *m, const char *want);
+static size_t feed_match(term_match_t *m, const char *buf, size_t len);
+
+static int open_bulk(hwtt_session_t *ses, int num, size_t keep,
+        bulk_sink_t *sink);
+static void feed_bulk(bulk_sink_t *sink, const char *buf, size_t len);
+static void save_bulk(bulk_sink_t *sink, const char *buf, size_t len);
+static int shut_bulk(bulk_sink_t *sink);
 
 // ---------------------- Public functions definitions ---------------------- //
 
-int exe_test(int num) {
+int exe_test(hwtt_session_t *ses, int num) {
     // Print an initial header with the number of the test.
     char msg_test[DEF_SMA_BUF_SIZE] = {0};
     sprintf(msg_test, "Test %02i", num);
-    write_header(stdout, report, msg_test);
+    write_header(ses->cmd, ses->report, msg_test);
+    test_time_t *t = &ses->phase[num];
+    memset(t, 0, sizeof(test_time_t));
+    t->beg = get_stamp();
 
-    // If a prompt exists, show it.
+    // If a prompt exists, show it, with heartbeats watching the link while the
+    // user reads it (a lost link is an error, before sending the request).
     if (  *prompt[num] != 0) {
-        input(stdout, report, prompt[num], NULL, 0, 0, 0, "\r");
-        output(stdout, report, "\n");
+        FILE *op = get_operator(ses, num);
+        t->prompt = get_stamp();
+        watch_link(ses);
+        input(op, ses->report, prompt[num], NULL, 0, 0, 0, "\r");
+        int lost = unwatch_link(ses);
+        t->prompt_ack = get_stamp();
+        output(op, ses->report, "\n");
+        put_operator(ses);
+        if (lost != 0) {
+            print_error(ses, "The link was lost while waiting for the user.");
+
+            return 1;
+        }
     }
 
-    // If a request exists, send it and receive the response.
-    if ( *request[num] != 0) {
-        ret = tx_req(num);
+    // If a file must be downloaded, send it to the PCBA. If the download fails,
+    // the test ends without request nor question.
+    int dl_fail = FALSE;
+    prof_mark_t pm = {0};
+    if (*download[num] != 0) {
+        prof_mark(&pm);
+        int ret = exe_dl(ses, num);
+        prof_add(&pm, PROF_LINK);
         if (ret != 0) {
             return 1;
         }
-        ret = rx_res(num);
+        dl_fail = (ses->result[num] != TEST_RES_PASS);
+    }
+
+    // If a request exists, send it and receive the response before the timeout
+    // of the test.
+    if ( *request[num] != 0 && dl_fail == FALSE) {
+        set_deadline(ses, get_timeout(num));
+        ses->rx_first = 0;
+        prof_mark(&pm);
+        int ret = tx_req(ses, num);
+        if (ret == 0) {
+            ret = rx_res(ses, num);
+        }
+        if (ret == 0) {
+            t->first = ses->rx_first;
+            t->term  = ses->rx_stamp;
+        }
+        if (ret == COMS_TIMEOUT) {
+            ret = put_timeout(ses, num);
+        }
+        prof_add(&pm, PROF_LINK);
         if (ret != 0) {
             return 1;
         }
-        output(stdout, report, "\n");
+        output(ses->cmd, ses->report, "\n");
     }
 
-    // If a question exists, ask it to the user.
-    if (*question[num] != 0) {
-        int answer = 0;
-        ask_yes_no(stdout, report, question[num], &answer);
+    // If a question exists, ask it to the user (unless the test timed out),
+    // also watching the link meanwhile.
+    if (*question[num] != 0 && ses->result[num] != TEST_RES_TIMEOUT &&
+            dl_fail == FALSE) {
+        int answer = (ses->answer[num] == 'Y') ? YES : NO;
+        FILE *op = get_operator(ses, num);
+        t->ask = get_stamp();
+        watch_link(ses);
+        ask_yes_no(op, ses->report, question[num], &answer);
+        int lost = unwatch_link(ses);
+        t->answer = get_stamp();
         if (answer == YES) {
-            result[num] = TEST_RES_PASS;
+            ses->result[num] = TEST_RES_PASS;
         } else {
-            result[num] = TEST_RES_FAIL;
+            ses->result[num] = TEST_RES_FAIL;
+        }
+        output(op, ses->report, "\n");
+        put_operator(ses);
+        if (lost != 0) {
+            print_error(ses, "The link was lost while waiting for the user.");
+
+            return 1;
         }
-        output(stdout, report, "\n");
     }
 
-    // If there is neither request nor question, set the result to PASS.
-    if (*request[num] == 0 && *question[num] == 0) {
+    // If there is neither request nor question (nor download, which sets the
+    // result), set the result to PASS.
+    if (*request[num] == 0 && *question[num] == 0 && *download[num] == 0) {
         if (*prompt[num] == 0) {
-            output(stdout, report, " -> This test does not exist!");
-            output(stdout, report, "\n");
-            output(stdout, report, "\n");
+            output(ses->cmd, ses->report, " -> This test does not exist!");
+            output(ses->cmd, ses->report, "\n");
+            output(ses->cmd, ses->report, "\n");
         }
-        result[num] = TEST_RES_PASS;
+        ses->result[num] = TEST_RES_PASS;
     }
 
-    // Display the result of the test.
-    dis_res(num);
+    // Display the timing and the result of the test.
+    t->end = get_stamp();
+    put_time(ses, num);
+    dis_res(ses, num);
 
     return 0;
 }
 
-void dis_res(int num) {
-    // Display the result of a test. The "all_ok" global flag is set if the
+int exe_cmd(hwtt_session_t *ses, const char *req, const char *ack, int *acked,
+        size_t *n_rcv) {
+    // Send the command and receive its response, keeping the last received
+    // bytes in a window as long as the acknowledgement with the _HWTT_TEST_END
+    // sequence, until the window ends with that sequence.
+    char end[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(end, "%s%s", ack, HWTT_TEST_END);
+    size_t len = strlen(end);
+    size_t tail = len - strlen(HWTT_TEST_END);
+    char buf[DEF_SMA_BUF_SIZE] = {0};
+    *n_rcv = 0;
+    set_deadline(ses, CONN_TIMEOUT_MS);
+    int ret = send_buf(ses, req, strlen(req));
+    while (ret == 0) {
+        char new = 0;
+        size_t n = 0;
+        ret = recv_buf(ses, &new, SINGLE_CHAR_SIZE, &n);
+        if (ret != 0) {
+            break;
+        }
+        shift_buf(buf, len, new);
+        (*n_rcv)++;
+        if (strcmp(&buf[tail], HWTT_TEST_END) == 0) {
+            *acked = (strcmp(buf, end) == 0);
+
+            return 0;
+        }
+    }
+
+    return ret;
+}
+
+int neg_frames(hwtt_session_t *ses) {
+    // Keep the ASCII responses, unless the binary frames are configured and
+    // the PCBA acknowledges them (any other response means that it does not
+    // support them).
+    ses->bin = FALSE;
+    if (BIN_FRAMES == 0) {
+        return 0;
+    }
+    output(ses->cmd, ses->report, " -> Negotiating frames ........ ");
+    int acked = FALSE;
+    size_t n_rcv = 0;
+    int ret = exe_cmd(ses, FRAME_CMD, FRAME_ACK, &acked, &n_rcv);
+    if (ret != 0) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
+
+        return 1;
+    }
+    if (acked == TRUE) {
+        ses->bin = TRUE;
+        output(ses->cmd, ses->report, "Binary");
+    } else {
+        output(ses->cmd, ses->report, "ASCII");
+    }
+    output(ses->cmd, ses->report, "\n");
+
+    return 0;
+}
+
+int get_batch(int num) {
+    // Count the consecutive tests with request but without prompt nor question
+    // (so without user interaction) from the given one, up to the window.
+    int n = 0;
+    while (n < PIPELINE_WINDOW && num + n < N_TESTS) {
+        int i = num + n;
+        if (*prompt[i] != 0 || *request[i] == 0 || *question[i] != 0 ||
+                payload[i] == PAYLOAD_BULK || *download[i] != 0) {
+            break;
+        }
+        n++;
+    }
+
+    return n;
+}
+
+int exe_batch(hwtt_session_t *ses, int num, int n) {
+    // Send all the requests back to back, without waiting for the responses.
+    // The deadline of the batch is the sum of the timeouts of its tests and, if
+    // it expires while sending, the remaining requests are not sent.
+    DWORD ms = 0;
+    LONGLONG beg = get_stamp();
+    for (int i = num; i < num + n; i++) {
+        ms += get_timeout(i);
+        memset(&ses->phase[i], 0, sizeof(test_time_t));
+        ses->phase[i].beg = beg;
+    }
+    set_deadline(ses, ms);
+    int n_tx = n;
+    for (int i = num; i < num + n; i++) {
+        size_t len = strlen(request[i]);
+        int ret = send_buf(ses, request[i], len);
+        ses->phase[i].req = get_stamp();
+        if (ret == COMS_TIMEOUT) {
+            n_tx = i - num;
+            break;
+        }
+        if (ret != 0) {
+            char msg_test[DEF_SMA_BUF_SIZE] = {0};
+            sprintf(msg_test, "Test %02i", i);
+            write_header(ses->cmd, ses->report, msg_test);
+            put_req_head(ses);
+            put_failed(ses);
+            print_error(ses, NULL);
+
+            return 1;
+        }
+    }
+
+    // Receive the responses, splitting the received bytes after every
+    // _XX_HWTT_TEST_END sequence (or taking every binary frame) and assigning
+    // each segment, with the arrival times of its first and last bytes, to the
+    // test whose number XX it carries.
+    char   want[N_TESTS] = {0};
+    char   *res[N_TESTS] = {0};
+    size_t res_len[N_TESTS] = {0};
+    for (int i = num; i < num + n_tx; i++) {
+        want[i] = TRUE;
+    }
+    int ret = (n_tx < n) ? COMS_TIMEOUT : 0;
+    const char *err = NULL;
+    for (int k = 0; k < n_tx && ret == 0; k++) {
+        ses->rx_first = 0;
+        if (ses->bin == TRUE) {
+            int    id = 0;
+            char   ec = 0;
+            char  *pay = NULL;
+            size_t pay_len = 0;
+            ret = rx_frame(ses, want, &id, &ec, &pay, &pay_len, NULL, &err);
+            if (ret != 0) {
+                break;
+            }
+            want[id] = FALSE;
+            res[id] = pay;
+            res_len[id] = pay_len;
+            ses->result[id] = get_res(ec);
+            ses->phase[id].first = ses->rx_first;
+            ses->phase[id].term  = ses->rx_stamp;
+            continue;
+        }
+        term_match_t m = {0};
+        init_match(&m, want);
+        char  *seg = NULL;
+        size_t seg_len = 0;
+        do {
+            const char *buf = NULL;
+            size_t      len = 0;
+            ret = rx_next(ses, &m, &buf, &len);
+            if (ret != 0) {
+                break;
+            }
+            char *new = realloc(seg, seg_len + len);
+            if (new == NULL) {
+                err = "Not enough memory to store the response.";
+                ret = 1;
+                break;
+            }
+            seg = new;
+            memcpy(&seg[seg_len], buf, len);
+            seg_len += len;
+            take_ring(ses, len);
+        } while (m.ec == 0);
+        if (ret != 0) {
+            free(seg);
+            break;
+        }
+        want[m.num] = FALSE;
+        res[m.num] = seg;
+        res_len[m.num] = seg_len;
+        ses->result[m.num] = get_res(m.ec);
+        ses->phase[m.num].first = ses->rx_first;
+        ses->phase[m.num].term  = ses->rx_stamp;
+    }
+
+    // Print every test in its original order, as if it had been executed
+    // alone, until the first one whose response was not received (if the
+    // deadline expired, the tests without response timed out instead).
+    for (int i = num; i < num + n; i++) {
+        char msg_test[DEF_SMA_BUF_SIZE] = {0};
+        sprintf(msg_test, "Test %02i", i);
+        write_header(ses->cmd, ses->report, msg_test);
+        put_req_head(ses);
+        if (i < num + n_tx) {
+            put_req_tail(ses, i);
+            put_res_head(ses);
+        }
+        if (i >= num + n_tx || want[i] == TRUE) {
+            put_failed(ses);
+            if (ret != COMS_TIMEOUT) {
+                print_error(ses, err);
+                break;
+            }
+            if (put_timeout(ses, i) != 0) {
+                ret = 1;
+                break;
+            }
+            output(ses->cmd, ses->report, "\n");
+            ses->phase[i].end = get_stamp();
+            put_time(ses, i);
+            dis_res(ses, i);
+            continue;
+        }
+        put_res(ses, res[i], res_len[i]);
+        put_res_tail(ses);
+        output(ses->cmd, ses->report, "\n");
+        ses->phase[i].end = ses->phase[i].term;
+        put_time(ses, i);
+        dis_res(ses, i);
+    }
+    for (int i = num; i < num + n; i++) {
+        free(res[i]);
+    }
+    if (ret == COMS_TIMEOUT) {
+        return 0;
+    }
+
+    return ret;
+}
+
+void dis_res(hwtt_session_t *ses, int num) {
+    // Display the result of a test. The "all_ok" session flag is set if the
     // first test [0] is successful, but if any test [0, N_TESTS - 1] is
     // unsuccessful, this flag is cleared.
     char buf[DEF_SMA_BUF_SIZE] = {0};
     sprintf(buf, " -> TEST %02i : ", num);
-    output(stdout, report, buf);
-    if (result[num] == TEST_RES_PASS) {
-        output(stdout, report, "PASS");
+    output(ses->cmd, ses->report, buf);
+    if (ses->result[num] == TEST_RES_PASS) {
+        output(ses->cmd, ses->report, "PASS");
         if (num == 0) {
-            all_ok = TRUE;
+            ses->all_ok = TRUE;
         }
     } else {
-        output(stdout, report, "FAIL");
+        if (ses->result[num] == TEST_RES_TIMEOUT) {
+            output(ses->cmd, ses->report, "TIMEOUT");
+        } else {
+            output(ses->cmd, ses->report, "FAIL");
+        }
         if (num < N_TESTS) {
-            all_ok = FALSE;
+            ses->all_ok = FALSE;
         }
     }
-    output(stdout, report, "\n");
+    output(ses->cmd, ses->report, "\n");
 }
 
 // --------------------- Private functions definitions ---------------------- //
 
-static int tx_req(int num) {
+static int tx_req(hwtt_session_t *ses, int num) {
     // Print the initial message.
-    if (report != NULL) {
-        output(stdout, NULL, " -> Sending request ........... ");
-        output(NULL, report, " >> ");
-    } else {
-        output(stdout, NULL, " >> ");
-    }
+    put_req_head(ses);
 
     // Send the request.
     size_t len = strlen(request[num]);
-    ret = send_buf(request[num], len);
+    int ret = send_buf(ses, request[num], len);
+    ses->phase[num].req = get_stamp();
+    if (ret == COMS_TIMEOUT) {
+        put_failed(ses);
+
+        return COMS_TIMEOUT;
+    }
     if (ret != 0) {
-        if (report != NULL) {
-            output(stdout, NULL, error_msg);
-            output(stdout, NULL, "\n");
-        }
-        print_error(NULL);
+        put_failed(ses);
+        print_error(ses, NULL);
 
         return 1;
     }
 
     // Print the request.
-    if (report != NULL) {
-        output(stdout, NULL, ok_msg);
-        output(NULL, report, request[num]);
+    put_req_tail(ses, num);
+
+    return 0;
+}
+
+static int exe_dl(hwtt_session_t *ses, int num) {
+    // Read the whole file once to get its size and CRC-32, which are checked
+    // by the PCBA at the end. A file that cannot be read fails the test.
+    char msg[DEF_BIG_BUF_SIZE] = {0};
+    output(ses->cmd, ses->report, " -> Downloading file .......... ");
+    ses->result[num] = TEST_RES_FAIL;
+    FILE *f = fopen(download[num], "rb");
+    LONGLONG size = 0;
+    DWORD    crc  = 0;
+    while (f != NULL) {
+        char buf[DEF_BIG_BUF_SIZE] = {0};
+        size_t n = fread(buf, 1, sizeof(buf), f);
+        size += n;
+        crc = crc32(crc, buf, n);
+        if (n < sizeof(buf)) {
+            break;
+        }
+    }
+    if (f == NULL || ferror(f) != 0) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, "The file to download could not be read.");
+        output(ses->cmd, ses->report, "\n");
+        if (f != NULL) {
+            fclose(f);
+        }
+
+        return 0;
+    }
+    DWORD n_chk = (DWORD)((size + DL_CHUNK_SIZE - 1) / DL_CHUNK_SIZE);
+    sprintf(msg, "%s (%lli bytes, %lu chunks)", download[num], size, n_chk);
+    output(ses->cmd, ses->report, msg);
+    output(ses->cmd, ses->report, "\n");
+
+    // Send the chunks with a sliding window of up to DL_WINDOW chunks without
+    // acknowledgement (go-back-N): every response carries the next chunk that
+    // the PCBA expects, which discards the chunks out of order or corrupted
+    // (answering them with FAIL). After a rejection or a timeout, the sending
+    // resumes from the last acknowledged chunk with an empty window, and the
+    // late responses to the chunks that were still in flight are counted
+    // apart as stale and ignored.
+    LARGE_INTEGER freq = {0};
+    LARGE_INTEGER beg  = {0};
+    LARGE_INTEGER end  = {0};
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&beg);
+    DWORD base = 0;
+    DWORD next = 0;
+    DWORD n_fly = 0;
+    DWORD n_stale = 0;
+    DWORD n_retry = 0;
+    int   timed_out = FALSE;
+    const char *err = NULL;
+    int ret = 0;
+    while (base < n_chk && n_retry <= DL_MAX_RETRIES) {
+        set_deadline(ses, get_timeout(num));
+        while (ret == 0 && next < n_chk && next < base + DL_WINDOW) {
+            ret = tx_chunk(ses, num, f, next, &err);
+            if (ret == 0) {
+                next++;
+                n_fly++;
+            }
+        }
+        DWORD ack = 0;
+        char  ec  = 0;
+        if (ret == 0) {
+            ret = rx_ack(ses, num, &ack, &ec, &err);
+        }
+        if (ret == COMS_TIMEOUT) {
+            ret = drop_ring(ses);
+            next = base;
+            n_stale += n_fly;
+            n_fly = 0;
+            n_retry++;
+            timed_out = TRUE;
+            continue;
+        }
+        if (ret != 0) {
+            break;
+        }
+        timed_out = FALSE;
+        if (ack > base && ack <= next) {
+            base = ack;
+        }
+        if (n_stale > 0) {
+            n_stale--;
+        } else if (ec != 'P') {
+            next = base;
+            n_stale = (n_fly > 0) ? n_fly - 1 : 0;
+            n_fly = 0;
+            n_retry++;
+        } else if (n_fly > 0) {
+            n_fly--;
+        }
+    }
+    fclose(f);
+
+    // Ask the PCBA to check the size and the CRC-32 of the whole file.
+    char ec = 0;
+    if (ret == 0 && base == n_chk) {
+        set_deadline(ses, get_timeout(num));
+        sprintf(msg, "D_%02i_END_%lli_%08lX\r", num, size, crc);
+        ret = send_buf(ses, msg, strlen(msg));
+        DWORD ack = 0;
+        if (ret == 0) {
+            ret = rx_ack(ses, num, &ack, &ec, &err);
+        }
+        if (ret == COMS_TIMEOUT) {
+            ret = drop_ring(ses);
+            timed_out = TRUE;
+        }
+    }
+    QueryPerformanceCounter(&end);
+    if (ret != 0) {
+        output(ses->cmd, ses->report, " -> Download result ........... ");
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, err);
+
+        return 1;
+    }
+
+    // Print the result and the statistics of the download.
+    output(ses->cmd, ses->report, " -> Download result ........... ");
+    if (ec == 'P') {
+        ses->result[num] = TEST_RES_PASS;
+        output(ses->cmd, ses->report, ok_msg);
+    } else if (timed_out == TRUE) {
+        ses->result[num] = TEST_RES_TIMEOUT;
+        output(ses->cmd, ses->report, "TIMEOUT");
     } else {
-        output(stdout, NULL, request[num]);
+        output(ses->cmd, ses->report, error_msg);
+    }
+    output(ses->cmd, ses->report, "\n");
+    LONGLONG us = (end.QuadPart - beg.QuadPart) * US_IN_ONE_S / freq.QuadPart;
+    if (us < 1) {
+        us = 1;
+    }
+    LONGLONG n_sent = (LONGLONG)base * DL_CHUNK_SIZE;
+    if (n_sent > size) {
+        n_sent = size;
     }
-    output(stdout, report, "\n");
+    sprintf(msg, " -> Download statistics ....... %lli B/s, %lu retries, CRC-"
+            "32 %08lX", n_sent * US_IN_ONE_S / us, n_retry, crc);
+    output(ses->cmd, ses->report, msg);
+    output(ses->cmd, ses->report, "\n");
+    output(ses->cmd, ses->report, "\n");
 
     return 0;
 }
 
-static int rx_res(int num) {
-    // Print the initial message.
-    if (report != NULL) {
-        output(stdout, NULL, " -> Receiving response ........ ");
-        output(NULL, report, " << ");
-    } else {
-        output(stdout, NULL, " << ");
-    }
-
-    // Receive characters one by one until the sequence _XX_HWTT_TEST_END is
-    // detected, where XX is the number of the current test (to do this, the
-    // last received characters are stored in a shift buffer and every time is
-    // searched in it the break condition end string).
-    const char _hwtt_test_end[] =    "_HWTT_TEST_END";
-    char    _xx_hwtt_test_end[] = "_XX_HWTT_TEST_END";
-    sprintf(_xx_hwtt_test_end, "_%02u%s", num, _hwtt_test_end);
-    char buf[SINGLE_CHAR_SIZE + sizeof(_xx_hwtt_test_end)] = {0};
-    size_t len = sizeof(buf) - NULL_TERMIN_SIZE;
-    do {
-        // Receive the next character.
-        char new = 0;
-        ret = recv_buf(&new, SINGLE_CHAR_SIZE);
+static int tx_chunk(hwtt_session_t *ses, int num, FILE *f, DWORD seq,
+        const char **err) {
+    // Read a chunk of the file (with a 64-bit offset, as the file may be
+    // larger than 2 GiB), failing the download if it cannot be read.
+    unsigned char buf[DL_CHUNK_SIZE] = {0};
+    size_t n = 0;
+    int ret = _fseeki64(f, (LONGLONG)seq * DL_CHUNK_SIZE, SEEK_SET);
+    if (ret == 0) {
+        n = fread(buf, 1, DL_CHUNK_SIZE, f);
+    }
+    if (ret != 0 || ferror(f) != 0) {
+        *err = "The file to download could not be read.";
+
+        return 1;
+    }
+
+    // Send it as a request with its sequence number, its bytes in hexadecimal
+    // and their CRC-32:
+    //
+    // D_<XX>_<SEQ (6 digits)>_<HEX DATA>_<CRC32 (8 hex digits)>\r
+    char   req[DL_REQ_SIZE] = {0};
+    size_t len = sprintf(req, "D_%02i_%06lu_", num, seq);
+    for (size_t i = 0; i < n; i++) {
+        len += sprintf(&req[len], "%02X", buf[i]);
+    }
+    len += sprintf(&req[len], "_%08lX\r", crc32(0, buf, n));
+
+    return send_buf(ses, req, len);
+}
+
+static int rx_ack(hwtt_session_t *ses, int num, DWORD *ack, char *ec,
+        const char **err) {
+    // Receive the response to a download request (as text or as a binary
+    // frame), whose payload starts with the number of the next chunk that the
+    // PCBA expects, and get that number and the error code.
+    char want[N_TESTS] = {0};
+    want[num] = TRUE;
+    char txt[DEF_SMA_BUF_SIZE] = {0};
+    if (ses->bin == TRUE) {
+        int    id  = 0;
+        char  *pay = NULL;
+        size_t len = 0;
+        int ret = rx_frame(ses, want, &id, ec, &pay, &len, NULL, err);
         if (ret != 0) {
-            if (report != NULL) {
-                output(stdout, NULL, error_msg);
-                output(stdout, NULL, "\n");
+            return ret;
+        }
+        if (len > sizeof(txt) - NULL_TERMIN_SIZE) {
+            len = sizeof(txt) - NULL_TERMIN_SIZE;
+        }
+        memcpy(txt, pay, len);
+        free(pay);
+    } else {
+        term_match_t m = {0};
+        init_match(&m, want);
+        size_t n_txt = 0;
+        do {
+            const char *buf = NULL;
+            size_t      len = 0;
+            int ret = rx_next(ses, &m, &buf, &len);
+            if (ret != 0) {
+                return ret;
             }
-            print_error(NULL);
+            for (size_t i = 0; i < len && n_txt < sizeof(txt) - 1; i++) {
+                txt[n_txt++] = buf[i];
+            }
+            take_ring(ses, len);
+        } while (m.ec == 0);
+        *ec = m.ec;
+    }
+    *ack = strtoul(txt, NULL, 10);
+
+    return 0;
+}
+
+static int rx_res(hwtt_session_t *ses, int num) {
+    // Print the initial message.
+    put_res_head(ses);
+
+    // Receive a binary frame, if negotiated.
+    if (ses->bin == TRUE) {
+        return rx_bin(ses, num);
+    }
+
+    // Open the sidecar file if the response is bulk data, holding back the
+    // bytes of the end sequence.
+    bulk_sink_t  bulk = {0};
+    bulk_sink_t *sink = NULL;
+    if (payload[num] == PAYLOAD_BULK) {
+        sink = &bulk;
+        int ret = open_bulk(ses, num, TERM_LEN, sink);
+        if (ret != 0) {
+            put_failed(ses);
+            print_error(ses, "The sidecar file could not be created.");
 
             return 1;
         }
+    }
 
-        // Insert the received character in the shift buffer.
-        shift_buf(buf, len, new);
-
-        // Write the received character to the report (full report modes) or to
-        // the screen (single test mode).
-        char str[] = {new, 0};
-        if (report != NULL) {
-            output(NULL, report, str);
+    // Receive the bytes until the sequence _XX_HWTT_TEST_END is detected, where
+    // XX is the number of the current test, and write them to the report (full
+    // report modes) or to the screen (single test mode), or stream them to the
+    // sidecar file.
+    char want[N_TESTS] = {0};
+    want[num] = TRUE;
+    term_match_t m = {0};
+    init_match(&m, want);
+    int ret = 0;
+    do {
+        const char *buf = NULL;
+        size_t      len = 0;
+        ret = rx_next(ses, &m, &buf, &len);
+        if (ret != 0) {
+            break;
+        }
+        if (sink != NULL) {
+            feed_bulk(sink, buf, len);
         } else {
-            output(stdout, NULL, str);
+            put_res(ses, buf, len);
+        }
+        take_ring(ses, len);
+    } while (m.ec == 0);
+    if (ret != 0) {
+        put_failed(ses);
+    }
+    if (ret != 0 && ret != COMS_TIMEOUT) {
+        print_error(ses, NULL);
+    }
+
+    // Close the sidecar file and print its reference instead of the data.
+    if (sink != NULL) {
+        int err = shut_bulk(sink);
+        if (ret == 0 && err != 0) {
+            put_failed(ses);
+            print_error(ses, "The sidecar file could not be written.");
+            ret = 1;
+        }
+        if (ret == 0) {
+            put_bulk(ses, sink);
         }
-    } while (strcmp(&buf[1], _xx_hwtt_test_end) != 0);
-    if (report != NULL) {
-        output(stdout, NULL, ok_msg);
     }
-    output(stdout, report, "\n");
+    if (ret != 0) {
+        return ret;
+    }
+    put_res_tail(ses);
 
-    // Determine the result of the test by scanning the character before the
+    // Determine the result of the test with the character before the
     // _XX_HWTT_TEST_END sequence. This result can be modified later in case
     // there is a question after the response.
-           if (*buf == 'P') {
-        result[num] = TEST_RES_PASS;
-    } else if (*buf == 'F') {
-        result[num] = TEST_RES_FAIL;
-    } else if (*buf == 'Q') {
-        result[num] = TEST_RES_QUESTION;
-    } else                  {
-        result[num] = TEST_RES_UNKNOWN;
+    ses->result[num] = get_res(m.ec);
+
+    return 0;
+}
+
+static int rx_next(hwtt_session_t *ses, term_match_t *m, const char **buf,
+        size_t *len) {
+    // Wait until the reader thread adds bytes to the ring buffer, if empty.
+    int ret = wait_ring(ses);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Feed the contiguous pending bytes to the streaming matcher, stopping
+    // after a terminator (the bytes received after it are left in the ring
+    // buffer), and return the consumed ones, which must be taken from the
+    // ring once used.
+    size_t idx = ses->rx_tail & RX_RING_MASK;
+    size_t n   = ses->rx_head - ses->rx_tail;
+    if (n > RX_RING_SIZE - idx) {
+        n = RX_RING_SIZE - idx;
+    }
+    n = feed_match(m, &ses->rx_ring[idx], n);
+    *buf = &ses->rx_ring[idx];
+    *len = n;
+
+    return 0;
+}
+
+static int rx_bin(hwtt_session_t *ses, int num) {
+    // Receive the binary frame of the current test and write its payload to
+    // the report (full report modes) or to the screen (single test mode), or
+    // stream it to the sidecar file if it is bulk data.
+    bulk_sink_t  bulk = {0};
+    bulk_sink_t *sink = NULL;
+    if (payload[num] == PAYLOAD_BULK) {
+        sink = &bulk;
+        int ret = open_bulk(ses, num, 0, sink);
+        if (ret != 0) {
+            put_failed(ses);
+            print_error(ses, "The sidecar file could not be created.");
+
+            return 1;
+        }
+    }
+    char want[N_TESTS] = {0};
+    want[num] = TRUE;
+    int   id  = 0;
+    char  ec  = 0;
+    char *pay = NULL;
+    size_t len = 0;
+    const char *err = NULL;
+    int ret = rx_frame(ses, want, &id, &ec, &pay, &len, sink, &err);
+    if (ret != 0) {
+        put_failed(ses);
+    }
+    if (ret != 0 && ret != COMS_TIMEOUT) {
+        print_error(ses, err);
+    }
+    if (sink != NULL) {
+        int fail = shut_bulk(sink);
+        if (ret == 0 && fail != 0) {
+            put_failed(ses);
+            print_error(ses, "The sidecar file could not be written.");
+            ret = 1;
+        }
+        if (ret == 0) {
+            put_bulk(ses, sink);
+        }
+    }
+    if (ret != 0) {
+        return ret;
+    }
+    if (sink == NULL) {
+        put_res(ses, pay, len);
+        free(pay);
+    }
+    put_res_tail(ses);
+
+    // Determine the result of the test with the error code of the frame.
+    ses->result[num] = get_res(ec);
+
+    return 0;
+}
+
+static int rx_frame(hwtt_session_t *ses, const char *want, int *num, char *ec,
+        char **pay, size_t *len, bulk_sink_t *sink, const char **err) {
+    // Receive the header of the frame and check that it belongs to one of the
+    // awaited tests:
+    //
+    // 'H' 'B' <XX> <EC> <LEN (4 bytes)> <PAYLOAD (LEN bytes)> <CRC32 (4 bytes)>
+    //
+    // The numbers are little endian and the CRC-32 covers the header and the
+    // payload.
+    unsigned char hdr[FRAME_HDR_SIZE] = {0};
+    int ret = recv_all(ses, hdr, FRAME_HDR_SIZE);
+    if (ret != 0) {
+        return ret;
+    }
+    int   id = hdr[FRAME_NUM_POS];
+    DWORD n  = get_le32(&hdr[FRAME_LEN_POS]);
+    if (hdr[0] != FRAME_MAGIC_0 || hdr[1] != FRAME_MAGIC_1) {
+        *err = "Invalid binary frame received.";
+
+        return 1;
+    }
+    if (id >= N_TESTS || want[id] != TRUE) {
+        *err = "Binary frame of an unexpected test received.";
+
+        return 1;
+    }
+    if (n > FRAME_MAX_LEN) {
+        *err = "Binary frame too long received.";
+
+        return 1;
+    }
+
+    // Receive exactly the announced payload (into memory, or streamed to the
+    // sink of the bulk data) and the CRC-32, and check it.
+    DWORD sum = crc32(0, hdr, FRAME_HDR_SIZE);
+    char *buf = NULL;
+    if (sink != NULL) {
+        ret = recv_bulk(ses, sink, n, &sum);
+    } else {
+        buf = malloc(n + NULL_TERMIN_SIZE);
+        if (buf == NULL) {
+            *err = "Not enough memory to store the response.";
+
+            return 1;
+        }
+        ret = recv_all(ses, buf, n);
+        sum = crc32(sum, buf, n);
+    }
+    unsigned char crc[FRAME_CRC_SIZE] = {0};
+    if (ret == 0) {
+        ret = recv_all(ses, crc, FRAME_CRC_SIZE);
+    }
+    if (ret != 0) {
+        free(buf);
+
+        return ret;
+    }
+    if (sum != get_le32(crc)) {
+        free(buf);
+        *err = "Corrupted binary frame received (CRC-32 mismatch).";
+
+        return 1;
+    }
+    if (buf != NULL) {
+        buf[n] = 0;
+    }
+    *num = id;
+    *ec  = hdr[FRAME_EC_POS];
+    *pay = buf;
+    *len = n;
+
+    return 0;
+}
+
+static int recv_all(hwtt_session_t *ses, void *buf, size_t len) {
+    // Receive exactly len number of bytes.
+    char *pos = buf;
+    while (len > 0) {
+        size_t n_rcv = 0;
+        int ret = recv_buf(ses, pos, len, &n_rcv);
+        if (ret != 0) {
+            return ret;
+        }
+        pos += n_rcv;
+        len -= n_rcv;
+    }
+
+    return 0;
+}
+
+static int recv_bulk(hwtt_session_t *ses, bulk_sink_t *sink, size_t len,
+        DWORD *crc) {
+    // Stream exactly len number of bytes from the ring buffer to the sink of
+    // the bulk data, without intermediate copies, updating a CRC-32 with them.
+    while (len > 0) {
+        int ret = wait_ring(ses);
+        if (ret != 0) {
+            return ret;
+        }
+        size_t idx = ses->rx_tail & RX_RING_MASK;
+        size_t n   = ses->rx_head - ses->rx_tail;
+        if (n > RX_RING_SIZE - idx) {
+            n = RX_RING_SIZE - idx;
+        }
+        if (n > len) {
+            n = len;
+        }
+        feed_bulk(sink, &ses->rx_ring[idx], n);
+        *crc = crc32(*crc, &ses->rx_ring[idx], n);
+        take_ring(ses, n);
+        len -= n;
+    }
+
+    return 0;
+}
+
+static DWORD get_le32(const unsigned char *buf) {
+    // Get a 32-bit little endian number.
+    return (DWORD)buf[0] | (DWORD)buf[1] << 8 | (DWORD)buf[2] << 16 |
+            (DWORD)buf[3] << 24;
+}
+
+static void put_req_head(hwtt_session_t *ses) {
+    // Print the initial message of a request.
+    if (ses->report != NULL) {
+        output(ses->cmd, NULL, " -> Sending request ........... ");
+        output(NULL, ses->report, " >> ");
+    } else {
+        output(ses->cmd, NULL, " >> ");
+    }
+}
+
+static void put_req_tail(hwtt_session_t *ses, int num) {
+    // Print a request that was successfully sent.
+    if (ses->report != NULL) {
+        output(ses->cmd, NULL, ok_msg);
+        output(NULL, ses->report, request[num]);
+    } else {
+        output(ses->cmd, NULL, request[num]);
+    }
+    output(ses->cmd, ses->report, "\n");
+}
+
+static void put_res_head(hwtt_session_t *ses) {
+    // Print the initial message of a response.
+    if (ses->report != NULL) {
+        output(ses->cmd, NULL, " -> Receiving response ........ ");
+        output(NULL, ses->report, " << ");
+    } else {
+        output(ses->cmd, NULL, " << ");
+    }
+}
+
+static void put_res_tail(hwtt_session_t *ses) {
+    // Print the end of a response that was successfully received.
+    if (ses->report != NULL) {
+        output(ses->cmd, NULL, ok_msg);
+    }
+    output(ses->cmd, ses->report, "\n");
+}
+
+static void put_failed(hwtt_session_t *ses) {
+    // Print the end of a request or a response that could not be completed.
+    if (ses->report != NULL) {
+        output(ses->cmd, NULL, error_msg);
+        output(ses->cmd, NULL, "\n");
+    }
+}
+
+static void put_res(hwtt_session_t *ses, const char *buf, size_t len) {
+    // Print a part of a response to the report (full report modes) or to the
+    // screen (single test mode). The payloads of the binary frames, which can
+    // have any byte, have the non printable ones escaped as \xHH (also the
+    // backslash), so that the report stays a text file.
+    FILE *cmd = (ses->report != NULL) ? NULL : ses->cmd;
+    if (ses->bin == FALSE) {
+        output_buf(cmd, ses->report, buf, len);
+
+        return;
+    }
+    char   esc[DEF_BIG_BUF_SIZE] = {0};
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = buf[i];
+        if (c >= PRINTABLE_MIN && c <= PRINTABLE_MAX && c != '\\') {
+            esc[n++] = c;
+        } else {
+            n += sprintf(&esc[n], "\\x%02X", c);
+        }
+        if (n > sizeof(esc) - DEF_SMA_BUF_SIZE) {
+            output_buf(cmd, ses->report, esc, n);
+            n = 0;
+        }
+    }
+    output_buf(cmd, ses->report, esc, n);
+}
+
+static void put_bulk(hwtt_session_t *ses, bulk_sink_t *sink) {
+    // Print the reference to the saved bulk data (its sidecar file name, size
+    // and CRC-32) instead of the data, followed by the held back end sequence.
+    const char *name = strrchr(sink->name, '\\');
+    name = (name != NULL) ? name + 1 : "Not saved";
+    char ref[DEF_BIG_BUF_SIZE] = {0};
+    sprintf(ref, "[Bulk data: %s, %llu bytes, CRC-32 %08lX] ", name,
+            (unsigned long long)sink->size, sink->crc);
+    FILE *cmd = (ses->report != NULL) ? NULL : ses->cmd;
+    output(cmd, ses->report, ref);
+    put_res(ses, sink->hold, sink->n_hold);
+}
+
+static int put_timeout(hwtt_session_t *ses, int num) {
+    // End the interrupted request or response line, print that the deadline
+    // expired and set the result of the test. What was received is discarded,
+    // so that the late end of the response is not taken as part of the next
+    // one; if the link was lost meanwhile, the execution cannot continue.
+    FILE *cmd = (ses->report != NULL) ? NULL : ses->cmd;
+    output(cmd, ses->report, "\n");
+    output(ses->cmd, ses->report, " -> Timeout, the deadline expired.");
+    output(ses->cmd, ses->report, "\n");
+    ses->result[num] = TEST_RES_TIMEOUT;
+    int ret = check_coms(ses);
+    if (ret == 0) {
+        ret = drop_ring(ses);
+    }
+    if (ret != 0) {
+        print_error(ses, "The link was lost after the timeout.");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static void put_time(hwtt_session_t *ses, int num) {
+    // Print in the report the duration of the test, the latency of the PCBA
+    // from the sending of the request until the first and the last bytes of
+    // its response arrived, and the time spent by the operator in the prompt
+    // and the question.
+    const test_time_t *t = &ses->phase[num];
+    char msg[DEF_MED_BUF_SIZE] = {0};
+    sprintf(msg, " -> Test duration ............. %lu ms",
+            get_us(t->beg, t->end) / US_IN_ONE_MS);
+    output(NULL, ses->report, msg);
+    output(NULL, ses->report, "\n");
+    if (t->term != 0) {
+        sprintf(msg, " -> Comms latency ............. %lu/%lu us (first/last)",
+                get_us(t->req, t->first), get_us(t->req, t->term));
+        output(NULL, ses->report, msg);
+        output(NULL, ses->report, "\n");
+    }
+    if (t->prompt != 0 || t->ask != 0) {
+        DWORD us = get_us(t->prompt, t->prompt_ack);
+        us += get_us(t->ask, t->answer);
+        sprintf(msg, " -> Operator time ............. %lu ms",
+                us / US_IN_ONE_MS);
+        output(NULL, ses->report, msg);
+        output(NULL, ses->report, "\n");
+    }
+}
+
+static test_res_t get_res(char ec) {
+    // Get the result of a test from the error code of its response.
+    test_res_t res = TEST_RES_UNKNOWN;
+           if (ec == 'P') {
+        res = TEST_RES_PASS;
+    } else if (ec == 'F') {
+        res = TEST_RES_FAIL;
+    } else if (ec == 'Q') {
+        res = TEST_RES_QUESTION;
+    }
+
+    return res;
+}
+
+static DWORD get_timeout(int num) {
+    // Get the timeout of a test, or the default one if it has none.
+    if (timeout[num] == 0) {
+        return DEF_TIMEOUT_MS;
+    }
+
+    return timeout[num];
+}
+
+static FILE *get_operator(hwtt_session_t *ses, int num) {
+    // Sessions with screen output (or without user, in the headless mode) talk
+    // to the user directly. Otherwise, wait for the console and identify the
+    // station before the prompt or question.
+    if (ses->cmd != NULL || is_headless() == TRUE) {
+        return ses->cmd;
+    }
+    lock_console();
+    char title[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(title, "Station %02i - Test %02i", ses->station, num);
+    write_header(stdout, NULL, title);
+
+    return stdout;
+}
+
+static void put_operator(hwtt_session_t *ses) {
+    // Release the console taken by a session without screen output.
+    if (ses->cmd == NULL && is_headless() == FALSE) {
+        unlock_console();
+    }
+}
+
+static void init_match(term_match_t *m, const char *want) {
+    // Reset the matcher and build the KMP failure function of the fixed
+    // _HWTT_TEST_END tail, so that no received byte is ever scanned twice.
+    const char tail[] = HWTT_TEST_END;
+    memset(m, 0, sizeof(*m));
+    m->want = want;
+    for (size_t i = 1, k = 0; i < sizeof(tail) - NULL_TERMIN_SIZE; i++) {
+        while (k > 0 && tail[i] != tail[k]) {
+            k = m->fail[k - 1];
+        }
+        if (tail[i] == tail[k]) {
+            k++;
+        }
+        m->fail[i] = k;
+    }
+}
+
+static size_t feed_match(term_match_t *m, const char *buf, size_t len) {
+    // Advance the automaton over the buffer, returning the number of consumed
+    // bytes (all of them, or up to the end of the _XX_HWTT_TEST_END sequence).
+    const char   tail[] = HWTT_TEST_END;
+    const size_t tlen   = sizeof(tail) - NULL_TERMIN_SIZE;
+    for (size_t i = 0; i < len; i++) {
+        char new = buf[i];
+        m->win[m->n_con & TERM_WIN_MASK] = new;
+        m->n_con++;
+        while (m->state > 0 && new != tail[m->state]) {
+            m->state = m->fail[m->state - 1];
+        }
+        if (new == tail[m->state]) {
+            m->state++;
+        }
+        if (m->state < tlen) {
+            continue;
+        }
+        m->state = m->fail[tlen - 1];
+
+        // The tail was found, so check that it is preceded by _<XX> with the
+        // number of an awaited test (and usually by <EC>, although a bare
+        // _XX_HWTT_TEST_END is accepted, with an unknown result).
+        if (m->n_con < tlen + TERM_XX_LEN) {
+            continue;
+        }
+        size_t pos = m->n_con - tlen - TERM_XX_LEN;
+        char xx[TERM_XX_LEN] = {0};
+        for (size_t j = 0; j < TERM_XX_LEN; j++) {
+            xx[j] = m->win[(pos + j) & TERM_WIN_MASK];
+        }
+        if (    xx[0] != '_' ||
+                isdigit((unsigned char)xx[1]) == 0 ||
+                isdigit((unsigned char)xx[2]) == 0) {
+            continue;
+        }
+        int num = (xx[1] - '0') * 10 + (xx[2] - '0');
+        if (num < N_TESTS && m->want[num] == TRUE) {
+            m->num = num;
+            m->ec  = 0;
+            if (m->n_con >= tlen + TERM_XX_LEN + TERM_EC_LEN) {
+                m->ec = m->win[(pos - TERM_EC_LEN) & TERM_WIN_MASK];
+            }
+            if (m->ec == 0) {
+                m->ec = '?';
+            }
+
+            return i + 1;
+        }
+    }
+
+    return len;
+}
+
+static int open_bulk(hwtt_session_t *ses, int num, size_t keep,
+        bulk_sink_t *sink) {
+    // Create the sidecar file of the bulk data of a test, with a big buffer so
+    // that it is written in large blocks (without TXT report, the data is not
+    // saved).
+    sink->keep = keep;
+    if (*ses->side == 0) {
+        return 0;
+    }
+    sprintf(sink->name, "%s_%02i.bin", ses->side, num);
+    sink->f = fopen(sink->name, "wb");
+    if (sink->f == NULL) {
+        return 1;
+    }
+    setvbuf(sink->f, NULL, _IOFBF, BULK_BUF_SIZE);
+
+    return 0;
+}
+
+static void feed_bulk(bulk_sink_t *sink, const char *buf, size_t len) {
+    // Save the received bytes except the last keep ones, which are held back
+    // (together with the previously held back ones).
+    size_t total = sink->n_hold + len;
+    if (total > sink->keep) {
+        size_t n_out = total - sink->keep;
+        size_t n_old = (n_out < sink->n_hold) ? n_out : sink->n_hold;
+        save_bulk(sink, sink->hold, n_old);
+        save_bulk(sink, buf, n_out - n_old);
+        memmove(sink->hold, &sink->hold[n_old], sink->n_hold - n_old);
+        sink->n_hold -= n_old;
+        buf += n_out - n_old;
+        len -= n_out - n_old;
+    }
+    memcpy(&sink->hold[sink->n_hold], buf, len);
+    sink->n_hold += len;
+}
+
+static void save_bulk(bulk_sink_t *sink, const char *buf, size_t len) {
+    // Write bytes to the sidecar file, if any, and account them.
+    if (len == 0) {
+        return;
+    }
+    if (sink->f != NULL) {
+        fwrite(buf, 1, len, sink->f);
+    }
+    sink->crc   = crc32(sink->crc, buf, len);
+    sink->size += len;
+}
+
+static int shut_bulk(bulk_sink_t *sink) {
+    // Close the sidecar file, if any, checking that all was written.
+    if (sink->f == NULL) {
+        return 0;
+    }
+    int err = ferror(sink->f);
+    int ret = fclose(sink->f);
+    sink->f = NULL;
+    if (err != 0 || ret != 0) {
+        return 1;
     }
 
     return 0;
@@ -49,16 +49,238 @@
 #define   NULL_TERMIN_SIZE                                                     1
 #define   MAX_BUILD_STR_SIZE                                                  26
 
+// -----------------------------------------------------------------------------
+// Fixed tail of the sequence that marks the end of a response
+// -----------------------------------------------------------------------------
+#define   HWTT_TEST_END                                         "_HWTT_TEST_END"
+
+// -----------------------------------------------------------------------------
+// Payload classes of the responses of the tests: text written in the TXT report
+// or bulk data saved to a sidecar binary file
+// -----------------------------------------------------------------------------
+#define   PAYLOAD_TEXT                                                         0
+#define   PAYLOAD_BULK                                                         1
+
+// -----------------------------------------------------------------------------
+// Exit codes of the headless mode: all the PCBAs passed, any of them failed,
+// any of them could not be tested, or the arguments or job file are invalid
+// -----------------------------------------------------------------------------
+#define   EXIT_ALL_PASS                                                        0
+#define   EXIT_SOME_FAIL                                                       1
+#define   EXIT_NOT_TESTED                                                      2
+#define   EXIT_BAD_JOB                                                         3
+
+// -----------------------------------------------------------------------------
+// Lengths of the data fields (and the allowed parities, which are not in any of
+// the charsets), shared by the user input and the headless mode checks
+// -----------------------------------------------------------------------------
+#define   MIN_USER_LEN                                                         1
+#define   MAX_USER_LEN                                                        27
+#define   MIN_COMP_LEN                                                         1
+#define   MAX_COMP_LEN                                                        27
+
+#define   MIN_BN_LEN                                                           1
+#define   MAX_BN_LEN                                                          27
+#define   MIN_SN_LEN                                                           1
+#define   MAX_SN_LEN                                                          27
+
+#define   MIN_IPV4_ADDR_LEN                                                    7
+#define   MAX_IPV4_ADDR_LEN                                                   15
+#define   MIN_TCP_PORT_LEN                                                     1
+#define   MAX_TCP_PORT_LEN                                                     5
+
+#define   MIN_COM_PORT_LEN                                                     1
+#define   MAX_COM_PORT_LEN                                                     6
+#define   MIN_BAUD_LEN                                                         3
+#define   MAX_BAUD_LEN                                                         7
+#define   PARITY_LEN                                                           1
+#define   MIN_STOP_LEN                                                         1
+#define   MAX_STOP_LEN                                                         3
+#define   PARITIES                                                       "NEOMS"
+
+// -----------------------------------------------------------------------------
+// Test in execution of a station that is not testing
+// -----------------------------------------------------------------------------
+#define   STAT_NO_TEST                                                      (-1)
+
+// -----------------------------------------------------------------------------
+// Return code of the communications functions when the deadline expires
+// -----------------------------------------------------------------------------
+#define   COMS_TIMEOUT                                                         2
+
+// -----------------------------------------------------------------------------
+// Sizes of the history fields of a PCBA in the index of the traceability CSV
+// -----------------------------------------------------------------------------
+#define   TRACE_DATE_SIZE                                                     20
+#define   TRACE_OK_SIZE                                                        4
+
+// -----------------------------------------------------------------------------
+// Size of a row of the traceability CSV, with a duration column per test
+// -----------------------------------------------------------------------------
+#define   CSV_COL_SIZE                                                        16
+#define   CSV_ROW_SIZE               (DEF_MED_BUF_SIZE + N_TESTS * CSV_COL_SIZE)
+
+// -----------------------------------------------------------------------------
+// Size of the receive ring buffer of a session (must be a power of two)
+// -----------------------------------------------------------------------------
+#define   RX_RING_SIZE                                                      4096
+#define   RX_RING_MASK                                        (RX_RING_SIZE - 1)
+
 // --------------------- Public data types declarations --------------------- //
 
+// -----------------------------------------------------------------------------
+// Result of a test
+// -----------------------------------------------------------------------------
+typedef enum test_res {
+    TEST_RES_UNKNOWN  = 0,
+    TEST_RES_QUESTION = 1,
+    TEST_RES_FAIL     = 2,
+    TEST_RES_PASS     = 3,
+    TEST_RES_TIMEOUT  = 4
+} test_res_t;
+
+// -----------------------------------------------------------------------------
+// Buckets of the cycle time profiler
+// -----------------------------------------------------------------------------
+typedef enum prof_bucket {
+    PROF_OPERATOR  = 0,
+    PROF_LINK      = 1,
+    PROF_FILES     = 2,
+    PROF_CONSOLE   = 3,
+    PROF_N_BUCKETS = 4
+} prof_bucket_t;
+
+// -----------------------------------------------------------------------------
+// Start of a profiled section: the nested sections are discounted from it, so
+// that every instant is accounted to a single bucket
+// -----------------------------------------------------------------------------
+typedef struct prof_mark {
+    LONGLONG    beg;                     // Timestamp at the start (QPC)
+    LONGLONG    acct;                    // Accounted time at the start (QPC)
+} prof_mark_t;
+
+// -----------------------------------------------------------------------------
+// Monotonic timestamps (QPC) of the phases of a test, 0 for the phases that it
+// did not go through
+// -----------------------------------------------------------------------------
+typedef struct test_time {
+    LONGLONG    beg;                     // Test started
+    LONGLONG    prompt;                  // Prompt shown
+    LONGLONG    prompt_ack;              // Prompt acknowledged
+    LONGLONG    req;                     // Request sent
+    LONGLONG    first;                   // First byte of the response arrived
+    LONGLONG    term;                    // Last byte of the response arrived
+    LONGLONG    ask;                     // Question shown
+    LONGLONG    answer;                  // Question answered
+    LONGLONG    end;                     // Test finished
+} test_time_t;
+
+// -----------------------------------------------------------------------------
+// Characterization of a link, measured by its probe when it was opened
+// -----------------------------------------------------------------------------
+typedef struct link_probe {
+    int         done;                    // TRUE if the link was probed
+    DWORD       rtt_p50;                 // Median round trip time (us)
+    DWORD       rtt_p95;                 // 95th percentile round trip (us)
+    DWORD       rtt_max;                 // Maximum round trip time (us)
+    DWORD       up_rate;                 // Throughput to PCBA (B/s), 0 if n/a
+    DWORD       dn_rate;                 // Throughput from PCBA (B/s), 0 if n/a
+} link_probe_t;
+
+// -----------------------------------------------------------------------------
+// Status of a session for the multi-station dashboard, written by its thread
+// and read by the main thread while the stations are testing
+// -----------------------------------------------------------------------------
+typedef struct station_stat {
+    volatile LONG test;                  // Test in execution or STAT_NO_TEST
+    volatile LONG last;                  // Result of the last finished test
+    volatile LONG n_pass;                // PCBAs passed since the start
+    volatile LONG n_fail;                // PCBAs failed or not finished
+    volatile LONG64 beg;                 // Start of the PCBA tests (QPC) or 0
+    volatile LONG64 end;                 // End of the PCBA tests (QPC) or 0
+} station_stat_t;
+
+// -----------------------------------------------------------------------------
+// Test session: everything needed to test one PCBA, so that several sessions
+// can run at the same time in separate threads without sharing any state
+// -----------------------------------------------------------------------------
+typedef struct hwtt_session {
+    FILE       *cmd;                     // Handle to stdout or NULL (quiet)
+    FILE       *report;                  // Handle to report or NULL
+    HANDLE      csv;                     // Handle to traceability CSV or NULL
+    HANDLE      h;                       // Serial port handle (UART)
+    HANDLE      rx_ov;                   // Serial port read event (UART)
+    HANDLE      tx_ov;                   // Serial port write event (UART)
+    UINT_PTR    s;                       // Socket (ETH)
+    int         link_up;                 // TRUE if the link is open
+    int         bin;                     // TRUE if responses are binary frames
+    link_probe_t probe;                  // Characterization of the link
+    ULONGLONG   deadline;                // Tick count when the I/O must end
+    char        addr[DEF_SMA_BUF_SIZE];  // COM port or IPv4 address
+    char        port[DEF_SMA_BUF_SIZE];  // TCP port (ETH)
+    char        baud[DEF_SMA_BUF_SIZE];  // Baud rate (UART)
+    char      parity[DEF_SMA_BUF_SIZE];  // Parity: N, E, O, M or S (UART)
+    char        stop[DEF_SMA_BUF_SIZE];  // Stop bits: 1, 1.5 or 2 (UART)
+    char        user[DEF_SMA_BUF_SIZE];  // User identification
+    char        comp[DEF_SMA_BUF_SIZE];  // Company identification
+    char          bn[DEF_SMA_BUF_SIZE];  // PCBA batch number
+    char          sn[DEF_SMA_BUF_SIZE];  // PCBA serial number
+    int         station;                 // Station number, 0 if only one
+    char        temp[DEF_SMA_BUF_SIZE];  // Temporal TXT report filename
+    char        file[DEF_SMA_BUF_SIZE];  // Saved TXT report filename
+    char        side[DEF_MED_BUF_SIZE];  // Sidecar files path prefix or ""
+    test_res_t  result[N_TESTS];         // Results of the tests
+    char        answer[N_TESTS];         // Headless answers (Y or N) or 0
+    test_time_t phase[N_TESTS];          // Timestamps of the tests phases
+    int         all_ok;                  // TRUE if all the tests were PASS
+    station_stat_t stat;                 // Status for the dashboard
+    char        rx_ring[RX_RING_SIZE];   // Bytes received but not processed
+    LONGLONG    rx_time[RX_RING_SIZE];   // Arrival time of each byte (QPC)
+    volatile LONG64 rx_head;             // Ring write index (free running)
+    volatile LONG64 rx_tail;             // Ring read index (free running)
+    LONGLONG    rx_first;                // Arrival time of first taken byte
+    LONGLONG    rx_stamp;                // Arrival time of last taken byte
+    HANDLE      rx_thread;               // Reader thread or NULL
+    HANDLE      rx_ready;                // Event: bytes added to the ring
+    HANDLE      rx_room;                 // Event: bytes taken from the ring
+    volatile LONG rx_stop;               // TRUE to stop the reader thread
+    volatile LONG rx_fail;               // TRUE if the reader thread failed
+    DWORD       rx_code;                 // Error code of the reader thread
+} hwtt_session_t;
+
+// -----------------------------------------------------------------------------
+// History of a PCBA, from the index of the traceability CSV
+// -----------------------------------------------------------------------------
+typedef struct trace_rec {
+    DWORD       n_runs;                  // Number of rows, 0 if never tested
+    char        date[TRACE_DATE_SIZE];   // Time and date of the last row
+    char        ok[TRACE_OK_SIZE];       // Whole result of the last row
+} trace_rec_t;
+
+// -----------------------------------------------------------------------------
+// Job of the background writer: the finished files of a tested PCBA, which are
+// closed by the writer thread (an empty job stops it)
+// -----------------------------------------------------------------------------
+typedef struct write_job {
+    FILE       *report;                  // Handle to the finished report
+    HANDLE      csv;                     // Handle to traceability CSV or NULL
+    char        temp[DEF_SMA_BUF_SIZE];  // Temporal TXT report filename
+    char        path[DEF_MED_BUF_SIZE];  // Final TXT report path
+    char        row[CSV_ROW_SIZE];       // Row of the traceability CSV
+} write_job_t;
+
 // ---------------- Public global data holders declarations ----------------- //
 
 // -----------------------------------------------------------------------------
-// Tests (prompts, requests and questions)
+// Tests (prompts, requests, questions, timeouts, payload classes and files
+// downloaded to the PCBA)
 // -----------------------------------------------------------------------------
 extern const char   *prompt[];
 extern const char  *request[];
 extern const char *question[];
+extern const DWORD  timeout[];
+extern const int    payload[];
+extern const char *download[];
 
 // -----------------------------------------------------------------------------
 // About information
@@ -91,23 +313,16 @@ extern const char   alphnum[];
 extern const char   num_dot[];
 extern const char       all[];
 
-// -----------------------------------------------------------------------------
-// Report file handle
-// -----------------------------------------------------------------------------
-extern FILE *report;
-
-// -----------------------------------------------------------------------------
-// Flag used to determine, in a full report mode, if all the tests were
-// successful (TRUE) or if at least one of them failed (FALSE)
-// -----------------------------------------------------------------------------
-extern int all_ok;
+// --------------------- Public functions declarations ---------------------- //
 
 // -----------------------------------------------------------------------------
-// General purpose return error code
+// Initialize a session, with the default data fields and no open files nor
+// communications.
 // -----------------------------------------------------------------------------
-extern long ret;
-
-// --------------------- Public functions declarations ---------------------- //
+void init_session(
+        hwtt_session_t *ses, // Session
+        FILE *cmd            // Handle to stdout or NULL
+);
 
 // -----------------------------------------------------------------------------
 // Write the header of a section, with its name centred with dashes at left and
@@ -128,7 +343,8 @@ void show_version(
 );
 
 // -----------------------------------------------------------------------------
-// Ask the user a question that must be answered with Yes or No ([Y/N]).
+// Ask the user a question that must be answered with Yes or No ([Y/N]). In the
+// headless mode, the given answer is taken.
 // -----------------------------------------------------------------------------
 void ask_yes_no(
         FILE *cmd,           // Handle to stdout or NULL
@@ -138,7 +354,10 @@ void ask_yes_no(
 );
 
 // -----------------------------------------------------------------------------
-// Ask the user to fill a field with data.
+// Ask the user to fill a field with data. In the headless mode, the default
+// data is taken as entered, as the batch mode checks it beforehand. With
+// SCAN_INPUT, a whole line is read and checked, and what follows SCAN_DELIM is
+// kept for the next field.
 // -----------------------------------------------------------------------------
 void input(
         FILE *cmd,           // Handle to stdout or NULL
@@ -151,6 +370,24 @@ void input(
         const char *charset  // Allowed charset (e.g. "0123456789")
 );
 
+// -----------------------------------------------------------------------------
+// Enter the headless mode, where nobody can type: the input fields and the
+// questions take the given data and answers.
+// -----------------------------------------------------------------------------
+void set_headless(void);
+
+// -----------------------------------------------------------------------------
+// Tell if the program runs in the headless mode.
+// -----------------------------------------------------------------------------
+int is_headless(void);
+
+// -----------------------------------------------------------------------------
+// Show on the screen the output buffered since the last frame.
+// -----------------------------------------------------------------------------
+void show_frame(
+        FILE *cmd            // Handle to stdout or NULL
+);
+
 // -----------------------------------------------------------------------------
 // Print a string.
 // -----------------------------------------------------------------------------
@@ -160,44 +397,279 @@ void output(
         const char *msg      // String to be printed
 );
 
+// -----------------------------------------------------------------------------
+// Print a buffer of a given length (it does not need to be NULL terminated).
+// -----------------------------------------------------------------------------
+void output_buf(
+        FILE *cmd,           // Handle to stdout or NULL
+        FILE *txt,           // Handle to report or NULL
+        const char *buf,     // Buffer to be printed
+        size_t len           // Length of the buffer in bytes
+);
+
 // -----------------------------------------------------------------------------
 // Perform all the tests, with all the debug information saved in a TXT report
 // file, and determining with the function's argument if the traceability CSV is
 // updated (TRUE) or not (FALSE).
 // -----------------------------------------------------------------------------
 void run_full(
+        hwtt_session_t *ses, // Session
         int prod             // Production/testing switch
 );
 
+// -----------------------------------------------------------------------------
+// Perform all the tests in production mode on several PCBAs at the same time,
+// one per station, each one with its own TXT report and CSV row.
+// -----------------------------------------------------------------------------
+void run_multi(
+        hwtt_session_t *ses  // Session (its user and company are shared)
+);
+
 // -----------------------------------------------------------------------------
 // Perform a single test, with all the debug information displayed on screen.
 // -----------------------------------------------------------------------------
-void run_single(void);
+void run_single(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Run the headless mode with the command line arguments (key=value pairs, with
+// the PCBAs listed in a job file or a single one in the arguments), testing the
+// PCBAs back to back without console setup nor user input, and returning the
+// exit code.
+// -----------------------------------------------------------------------------
+int run_batch(
+        int argc,            // Number of arguments
+        char *argv[]         // Arguments
+);
 
 // -----------------------------------------------------------------------------
 // Start the communications with the PCBA via serial port or Ethernet.
 // -----------------------------------------------------------------------------
-int init_coms(void);
+int init_coms(
+        hwtt_session_t *ses  // Session
+);
 
 // -----------------------------------------------------------------------------
 // Stop the communications with the PCBA via serial port or Ethernet.
 // -----------------------------------------------------------------------------
-int shut_coms(void);
+int shut_coms(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Pick the traceability CSV whose header matches the columns of this build and
+// start the background writer thread.
+// -----------------------------------------------------------------------------
+int init_writer(void);
+
+// -----------------------------------------------------------------------------
+// Get the name of a file of the picked traceability CSV (the CSV itself or its
+// index) from its extension.
+// -----------------------------------------------------------------------------
+void get_csv_name(
+        char *name,          // Buffer for the name
+        const char *ext      // Extension, without the dot (e.g. "csv")
+);
+
+// -----------------------------------------------------------------------------
+// Queue a job for the background writer, blocking only if the queue is full.
+// -----------------------------------------------------------------------------
+void push_writer(
+        const write_job_t *job  // Job to be queued (copied)
+);
+
+// -----------------------------------------------------------------------------
+// Print the failures of the background writer not shown yet, if any.
+// -----------------------------------------------------------------------------
+void show_writer(
+        FILE *cmd            // Handle to stdout
+);
+
+// -----------------------------------------------------------------------------
+// Wait until the background writer saves all the queued jobs and stop it,
+// printing the failures not shown yet.
+// -----------------------------------------------------------------------------
+void shut_writer(
+        FILE *cmd            // Handle to stdout
+);
+
+// -----------------------------------------------------------------------------
+// Take the lock of the traceability CSV, shared by all the stations and
+// programs that append rows to it or update its index.
+// -----------------------------------------------------------------------------
+int lock_csv(
+        HANDLE csv           // Handle to traceability CSV
+);
+
+// -----------------------------------------------------------------------------
+// Release the lock of the traceability CSV.
+// -----------------------------------------------------------------------------
+void unlock_csv(
+        HANDLE csv           // Handle to traceability CSV
+);
+
+// -----------------------------------------------------------------------------
+// Add to the index of the traceability CSV the rows appended since the last
+// time, creating or rebuilding it if needed. The lock must be held.
+// -----------------------------------------------------------------------------
+int sync_trace(
+        HANDLE csv           // Handle to traceability CSV
+);
+
+// -----------------------------------------------------------------------------
+// Look up the history of a PCBA in the index of the traceability CSV, updating
+// it first with the rows appended by other stations or programs.
+// -----------------------------------------------------------------------------
+int find_trace(
+        const char *bn,      // PCBA batch number
+        const char *sn,      // PCBA serial number
+        trace_rec_t *rec     // History of the PCBA
+);
+
+// -----------------------------------------------------------------------------
+// Check, without blocking, that the open communications with the PCBA are still
+// alive.
+// -----------------------------------------------------------------------------
+int check_coms(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Open the link with the PCBA, reusing the one of a previous execution if it is
+// still alive, and print whether it was reused or freshly opened. A new link is
+// probed (round trip times and throughput), failing if it is below the limits,
+// and the results of its probe are printed every time.
+// -----------------------------------------------------------------------------
+int open_link(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Close the link with the PCBA, if it is open.
+// -----------------------------------------------------------------------------
+int close_link(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Time the transfer of a number of bytes of filler from the PCBA with the
+// reserved request of the link probe, getting the throughput from the bytes
+// actually received and discounting a round trip time (0 if the PCBA does not
+// support it).
+// -----------------------------------------------------------------------------
+int time_down(
+        hwtt_session_t *ses, // Session
+        DWORD size,          // Bytes of filler requested
+        DWORD rtt,           // Round trip time to discount, in microseconds
+        DWORD *rate          // Throughput, in bytes per second, or 0
+);
+
+// -----------------------------------------------------------------------------
+// Close the links of all the stations of the multi-station mode.
+// -----------------------------------------------------------------------------
+void shut_multi(void);
+
+// -----------------------------------------------------------------------------
+// Read from the PCBA via serial port or Ethernet the bytes that are available,
+// waiting for the first one until the deadline of the session at most (no
+// bytes is not a failure). The reader thread of a serial port waits until the
+// thread is asked to stop instead.
+// -----------------------------------------------------------------------------
+int read_coms(
+        hwtt_session_t *ses, // Session
+        char *buf,           // Buffer to store the read bytes
+        size_t len,          // Maximum number of bytes to read
+        size_t *n_rcv        // Number of bytes actually read (0 if none)
+);
+
+// -----------------------------------------------------------------------------
+// Start draining the open link of a session into its receive ring buffer, with
+// the arrival time of every byte: a reader thread for a serial port, or the
+// poller thread shared by all the sockets.
+// -----------------------------------------------------------------------------
+int init_reader(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Stop draining the link of a session, if it is being drained, and empty the
+// receive ring buffer.
+// -----------------------------------------------------------------------------
+void shut_reader(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Wait until the receive ring buffer has pending bytes, returning COMS_TIMEOUT
+// if the deadline of the session expires before. Without reader thread, the
+// link is read directly.
+// -----------------------------------------------------------------------------
+int wait_ring(
+        hwtt_session_t *ses  // Session
+);
 
 // -----------------------------------------------------------------------------
-// Send a buffer to the PCBA via serial port or Ethernet.
+// Take from the receive ring buffer a number of pending bytes already used,
+// noting the arrival time of the last one (and of the first one, if the noted
+// one was cleared).
+// -----------------------------------------------------------------------------
+void take_ring(
+        hwtt_session_t *ses, // Session
+        size_t n             // Number of bytes
+);
+
+// -----------------------------------------------------------------------------
+// Discard the pending bytes of the receive ring buffer, failing if the reader
+// thread lost the link.
+// -----------------------------------------------------------------------------
+int drop_ring(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Send a buffer to the PCBA via serial port or Ethernet, returning COMS_TIMEOUT
+// if the deadline of the session expires.
 // -----------------------------------------------------------------------------
 int send_buf(
+        hwtt_session_t *ses, // Session
         const char *buf,     // Buffer to be sent
         size_t len           // Length of the buffer in bytes
 );
 
 // -----------------------------------------------------------------------------
-// Receive a buffer from the PCBA via serial port or Ethernet.
+// Receive a buffer from the PCBA through the receive ring buffer, blocking
+// until at least one byte arrives and then returning as many bytes as
+// available, or returning COMS_TIMEOUT if the deadline of the session expires
+// before.
 // -----------------------------------------------------------------------------
 int recv_buf(
+        hwtt_session_t *ses, // Session
         char *buf,           // Buffer to store the received bytes
-        size_t len           // Number of bytes to receive
+        size_t len,          // Maximum number of bytes to receive
+        size_t *n_rcv        // Number of bytes actually received
+);
+
+// -----------------------------------------------------------------------------
+// Send a reserved command (not a test) and receive its response up to the
+// _HWTT_TEST_END sequence before CONN_TIMEOUT_MS, telling if the response is
+// the given acknowledgement followed by that sequence, or returning
+// COMS_TIMEOUT if it did not arrive in time.
+// -----------------------------------------------------------------------------
+int exe_cmd(
+        hwtt_session_t *ses, // Session
+        const char *req,     // Command, finished in \r
+        const char *ack,     // Acknowledgement ("" if not needed)
+        int *acked,          // TRUE if acknowledged
+        size_t *n_rcv        // Number of received bytes
+);
+
+// -----------------------------------------------------------------------------
+// Propose the binary response frames to the PCBA, if configured, using them
+// from now on if it accepts.
+// -----------------------------------------------------------------------------
+int neg_frames(
+        hwtt_session_t *ses  // Session
 );
 
 // -----------------------------------------------------------------------------
@@ -210,14 +682,45 @@ int recv_buf(
 // X        | Yes      | No       || Determined by the response to the request
 // X        | X        | Yes      || PASS if Yes, FAIL if No (question's answer)
 // -----------------------------------------------------------------------------
+//
+// If the request is not sent or its response is not received before the
+// timeout of the test, the result is TIMEOUT (the question is not asked) and
+// the execution continues with the next test.
+//
+// If the test has a file to download, it is sent to the PCBA after the prompt,
+// and a failed download ends the test as FAIL (or TIMEOUT) without request nor
+// question; otherwise, a successful download alone is a PASS.
+// -----------------------------------------------------------------------------
 int exe_test(
+        hwtt_session_t *ses, // Session
         int num              // Number of the test
 );
 
+// -----------------------------------------------------------------------------
+// Get the number of consecutive tests, starting from a given one, that can be
+// executed in a pipelined batch (with request but without prompt nor question,
+// and without bulk data nor download), limited by PIPELINE_WINDOW.
+// -----------------------------------------------------------------------------
+int get_batch(
+        int num              // Number of the first test
+);
+
+// -----------------------------------------------------------------------------
+// Execute a batch of consecutive tests without user interaction, sending all
+// the requests before receiving the responses, which are matched to the tests
+// by their numbers. The tests are printed in their original order.
+// -----------------------------------------------------------------------------
+int exe_batch(
+        hwtt_session_t *ses, // Session
+        int num,             // Number of the first test
+        int n                // Number of tests
+);
+
 // -----------------------------------------------------------------------------
 // Display the result of a test.
 // -----------------------------------------------------------------------------
 void dis_res(
+        hwtt_session_t *ses, // Session
         int num              // Number of the test
 );
 
@@ -232,12 +735,156 @@ void shift_buf(
         char new             // New character
 );
 
+// -----------------------------------------------------------------------------
+// Set the deadline of the communications of a session, from now on.
+// -----------------------------------------------------------------------------
+void set_deadline(
+        hwtt_session_t *ses, // Session
+        DWORD ms             // Milliseconds until the deadline
+);
+
+// -----------------------------------------------------------------------------
+// Get the milliseconds left until the deadline of a session (0 if expired).
+// -----------------------------------------------------------------------------
+DWORD get_remaining(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Start profiling a run of the calling thread, if the profiler is enabled.
+// -----------------------------------------------------------------------------
+void init_prof(void);
+
+// -----------------------------------------------------------------------------
+// Mark the start of a profiled section of the calling thread.
+// -----------------------------------------------------------------------------
+void prof_mark(
+        prof_mark_t *m       // Start of the section
+);
+
+// -----------------------------------------------------------------------------
+// Account the time since the start of a profiled section, except the one of
+// its nested sections, to a bucket.
+// -----------------------------------------------------------------------------
+void prof_add(
+        const prof_mark_t *m, // Start of the section
+        prof_bucket_t b       // Bucket
+);
+
+// -----------------------------------------------------------------------------
+// End the run of the calling thread, printing its profile with the totals of
+// the session and appending them to the profile log.
+// -----------------------------------------------------------------------------
+void show_prof(
+        FILE *cmd            // Handle to stdout or NULL
+);
+
+// -----------------------------------------------------------------------------
+// Create the event that wakes up the supervisor thread (without it, the links
+// are not watched).
+// -----------------------------------------------------------------------------
+int init_super(void);
+
+// -----------------------------------------------------------------------------
+// Run the supervisor thread, which never ends: it kills the program if the
+// console window is put in full screen, and sends the heartbeats of the watched
+// links, sleeping until the next event, heartbeat or failure of a link.
+// -----------------------------------------------------------------------------
+void super_thread(void);
+
+// -----------------------------------------------------------------------------
+// Start sending heartbeats to the PCBA every HEARTBEAT_MS, from the supervisor
+// thread, while the session waits for the user (it must not use the link until
+// unwatch_link() is called).
+// -----------------------------------------------------------------------------
+void watch_link(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Stop sending heartbeats to the PCBA, telling if any of them failed.
+// -----------------------------------------------------------------------------
+int unwatch_link(
+        hwtt_session_t *ses  // Session
+);
+
+// -----------------------------------------------------------------------------
+// Wake up the supervisor thread, so that it checks the watched links at once
+// (called when a reader thread finds its link failed).
+// -----------------------------------------------------------------------------
+void wake_super(void);
+
+// -----------------------------------------------------------------------------
+// Forget the drawn dashboard, so that the next one is printed in full.
+// -----------------------------------------------------------------------------
+void init_dash(void);
+
+// -----------------------------------------------------------------------------
+// Draw the status of the stations, rewriting only the cells that changed since
+// the last time unless something else was printed meanwhile.
+// -----------------------------------------------------------------------------
+void show_dash(
+        const hwtt_session_t *st, // Sessions of the stations
+        int n_st             // Number of stations
+);
+
+// -----------------------------------------------------------------------------
+// Get a monotonic high resolution timestamp (QPC).
+// -----------------------------------------------------------------------------
+LONGLONG get_stamp(void);
+
+// -----------------------------------------------------------------------------
+// Get the microseconds between two timestamps (0 if any of them is missing).
+// -----------------------------------------------------------------------------
+DWORD get_us(
+        LONGLONG beg,        // Earlier timestamp or 0
+        LONGLONG end         // Later timestamp or 0
+);
+
+// -----------------------------------------------------------------------------
+// Update a CRC-32 (IEEE 802.3, as in ZIP or Ethernet) with a buffer, starting
+// from 0.
+// -----------------------------------------------------------------------------
+DWORD crc32(
+        DWORD crc,           // CRC-32 of the previous bytes (0 if none)
+        const void *buf,     // Buffer
+        size_t len           // Length of the buffer in bytes
+);
+
+// -----------------------------------------------------------------------------
+// Take exclusive ownership of the console, so that several sessions running in
+// separate threads do not mix their screen output and keyboard input.
+// -----------------------------------------------------------------------------
+void lock_console(void);
+
+// -----------------------------------------------------------------------------
+// Release the ownership of the console.
+// -----------------------------------------------------------------------------
+void unlock_console(void);
+
+// -----------------------------------------------------------------------------
+// Wait until the background writer saves all the queued jobs and end the
+// program with failure.
+// -----------------------------------------------------------------------------
+void kill_program(void);
+
+// -----------------------------------------------------------------------------
+// Hide the console window, prompt an error message in a message box and end the
+// program with failure.
+// -----------------------------------------------------------------------------
+void prompt_error(
+        const char *top,     // Title of the message box
+        const char *msg      // Error message
+);
+
 // -----------------------------------------------------------------------------
 // Print a custom error message or, if NULL is passed as argument, a Windows
 // error message related with communications is gotten using GetLastError() for
-// (U)ART or WSAGetLastError() for (E)thernet.
+// (U)ART or WSAGetLastError() for (E)thernet. In sessions without screen output
+// it is printed to the report.
 // -----------------------------------------------------------------------------
 void print_error(
+        hwtt_session_t *ses, // Session
         const char *msg      // Custom error message
 );
 
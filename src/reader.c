@@ -0,0 +1,523 @@
+// -----------------------------------------------------------------------------
+// READER_C
+//
+// - Reader of the links, which keeps draining them into the receive ring
+//   buffers of their sessions, so that nothing is lost while the tests wait
+//   for the user or between them: a thread per serial port, or a single poller
+//   thread for all the sockets
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  <winsock2.h>
+#include  "public.h"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   DROP_WAIT_MS                                                         1
+
+#define   POLL_SET_SIZE                                       (MAX_STATIONS + 2)
+#define   POLL_WAKE_BYTE                                                     'W'
+#define   POLL_NO_TIMEOUT                                                     -1
+
+#define   WSA_VERSION                                                          2
+#define   WSA_SUBVERSION                                                       2
+#define   WSA_VALUE           (WSA_VERSION << BITS_IN_ONE_BYTE) | WSA_SUBVERSION
+
+// -------------------- Private data types declarations --------------------- //
+
+// --------------- Public global data holders initializations --------------- //
+
+// -------------- Private global data holders initializations --------------- //
+
+#if       (ETH == 1)
+static SRWLOCK         poll_lock = SRWLOCK_INIT;
+static hwtt_session_t *poll_ses[POLL_SET_SIZE] = {0};
+static int             poll_n    = 0;
+static int             poll_on   = FALSE;
+static SOCKET          poll_wake = INVALID_SOCKET;
+#endif // (ETH == 1)
+
+// --------------------- Private functions declarations --------------------- //
+
+#if       (UART == 1)
+static void reader_thread(hwtt_session_t *ses);
+#endif // (UART == 1)
+static int fill_ring(hwtt_session_t *ses);
+static void fail_ring(hwtt_session_t *ses);
+static void give_room(hwtt_session_t *ses, int full);
+#if       (ETH == 1)
+static void poll_thread(void);
+static int add_poll(hwtt_session_t *ses);
+static void del_poll(hwtt_session_t *ses);
+static int is_polled(hwtt_session_t *ses);
+static SOCKET open_wake(void);
+static void wake_poll(void);
+static void drain_wake(void);
+#endif // (ETH == 1)
+static DWORD get_error(void);
+static void set_error(DWORD code);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+int init_reader(hwtt_session_t *ses) {
+    // Create the events that wake up the consumer when bytes arrive and the
+    // reader thread when the full ring has room again.
+    ses->rx_stop  = FALSE;
+    ses->rx_fail  = FALSE;
+    ses->rx_ready = CreateEventA(NULL, FALSE, FALSE, NULL);
+    ses->rx_room  = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (ses->rx_ready == NULL || ses->rx_room == NULL) {
+        shut_reader(ses);
+
+        return 1;
+    }
+
+    // Hand the socket to the poller thread, or start the reader thread of the
+    // serial port.
+#if       (ETH == 1)
+    int ret = add_poll(ses);
+    if (ret != 0) {
+        shut_reader(ses);
+
+        return 1;
+    }
+#else  // (ETH == 1)
+    ses->rx_thread = CreateThread(NULL, 0, (void *)reader_thread, ses, 0,
+            NULL);
+    if (ses->rx_thread == NULL) {
+        shut_reader(ses);
+
+        return 1;
+    }
+#endif // (ETH == 1)
+
+    return 0;
+}
+
+void shut_reader(hwtt_session_t *ses) {
+    // Take the socket out of the poller thread, or ask the reader thread to
+    // stop and wait until its last read ends, which takes a short time at
+    // most.
+#if       (ETH == 1)
+    del_poll(ses);
+#endif // (ETH == 1)
+    if (ses->rx_thread != NULL) {
+        InterlockedExchange(&ses->rx_stop, TRUE);
+        SetEvent(ses->rx_room);
+        WaitForSingleObject(ses->rx_thread, INFINITE);
+        CloseHandle(ses->rx_thread);
+        ses->rx_thread = NULL;
+    }
+    if (ses->rx_ready != NULL) {
+        CloseHandle(ses->rx_ready);
+        ses->rx_ready = NULL;
+    }
+    if (ses->rx_room != NULL) {
+        CloseHandle(ses->rx_room);
+        ses->rx_room = NULL;
+    }
+
+    // Empty the ring, as the next link starts a new stream.
+    ses->rx_head = 0;
+    ses->rx_tail = 0;
+    ses->rx_fail = FALSE;
+}
+
+int wait_ring(hwtt_session_t *ses) {
+    // Wait for pending bytes, or read them directly if nothing drains the link
+    // (as while it is being opened), showing the screen built so far.
+    for (;;) {
+        if (ses->rx_head != ses->rx_tail) {
+            return 0;
+        }
+        if (ses->rx_fail == TRUE) {
+            set_error(ses->rx_code);
+
+            return 1;
+        }
+        DWORD ms = get_remaining(ses);
+        if (ms == 0) {
+            set_error((*coms == 'U') ? ERROR_TIMEOUT : WSAETIMEDOUT);
+
+            return COMS_TIMEOUT;
+        }
+        show_frame(ses->cmd);
+        if (ses->rx_ready == NULL) {
+            int ret = fill_ring(ses);
+            if (ret != 0) {
+                return 1;
+            }
+        } else {
+            WaitForSingleObject(ses->rx_ready, ms);
+        }
+    }
+}
+
+void take_ring(hwtt_session_t *ses, size_t n) {
+    // Advance the read index once the bytes are no longer needed, so that the
+    // reader thread does not overwrite them before, and wake it up if it was
+    // waiting for room. The arrival times of the first taken byte (since it
+    // was cleared) and of the last one are noted for the timings.
+    if (n == 0) {
+        return;
+    }
+    if (ses->rx_first == 0) {
+        ses->rx_first = ses->rx_time[ses->rx_tail & RX_RING_MASK];
+    }
+    LONG64 tail = ses->rx_tail + n;
+    int    full = (ses->rx_head - ses->rx_tail == RX_RING_SIZE);
+    ses->rx_stamp = ses->rx_time[(tail - 1) & RX_RING_MASK];
+    InterlockedExchange64(&ses->rx_tail, tail);
+    give_room(ses, full);
+}
+
+int drop_ring(hwtt_session_t *ses) {
+    // Discard the pending bytes. If the ring was full, the reader thread may
+    // have more waiting in the driver, so it is given time to add them and
+    // they are discarded too.
+    for (;;) {
+        LONG64 head = ses->rx_head;
+        LONG64 n    = head - ses->rx_tail;
+        InterlockedExchange64(&ses->rx_tail, head);
+        give_room(ses, n == RX_RING_SIZE);
+        if (n < RX_RING_SIZE || ses->rx_ready == NULL) {
+            break;
+        }
+        Sleep(DROP_WAIT_MS);
+    }
+
+    // A link lost meanwhile cannot be used anymore.
+    if (ses->rx_fail == TRUE) {
+        set_error(ses->rx_code);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+int recv_buf(hwtt_session_t *ses, char *buf, size_t len, size_t *n_rcv) {
+    // Copy up to len number of contiguous pending bytes, once they arrive.
+    int ret = wait_ring(ses);
+    if (ret != 0) {
+        return ret;
+    }
+    size_t idx = ses->rx_tail & RX_RING_MASK;
+    size_t n   = ses->rx_head - ses->rx_tail;
+    if (n > RX_RING_SIZE - idx) {
+        n = RX_RING_SIZE - idx;
+    }
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buf, &ses->rx_ring[idx], n);
+    take_ring(ses, n);
+    *n_rcv = n;
+
+    return 0;
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+#if       (UART == 1)
+
+static void reader_thread(hwtt_session_t *ses) {
+    // Drain the serial port until asked to stop, waiting for the consumer while
+    // the ring is full (the bytes are kept meanwhile by the driver), which sets
+    // the room event once it takes bytes, as the stop does. A failure is
+    // published for the consumer, which gets its error code when the ring runs
+    // out of bytes.
+    while (ses->rx_stop == FALSE) {
+        if (ses->rx_head - ses->rx_tail == RX_RING_SIZE) {
+            WaitForSingleObject(ses->rx_room, INFINITE);
+            continue;
+        }
+        int ret = fill_ring(ses);
+        if (ret != 0) {
+            fail_ring(ses);
+            break;
+        }
+    }
+}
+
+#endif // (UART == 1)
+
+static int fill_ring(hwtt_session_t *ses) {
+    // Read into the contiguous free space of the ring, stamping the new bytes
+    // with the time of the read, and publish them after they are stored.
+    LONG64 head = ses->rx_head;
+    size_t idx  = head & RX_RING_MASK;
+    size_t len  = RX_RING_SIZE - (head - ses->rx_tail);
+    if (len > RX_RING_SIZE - idx) {
+        len = RX_RING_SIZE - idx;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    size_t n_rcv = 0;
+    int ret = read_coms(ses, &ses->rx_ring[idx], len, &n_rcv);
+    if (ret != 0) {
+        return 1;
+    }
+    if (n_rcv == 0) {
+        return 0;
+    }
+    LARGE_INTEGER now = {0};
+    QueryPerformanceCounter(&now);
+    for (size_t i = 0; i < n_rcv; i++) {
+        ses->rx_time[idx + i] = now.QuadPart;
+    }
+    InterlockedExchange64(&ses->rx_head, head + n_rcv);
+    if (ses->rx_ready != NULL) {
+        SetEvent(ses->rx_ready);
+    }
+
+    return 0;
+}
+
+static void fail_ring(hwtt_session_t *ses) {
+    // Publish a failure of the link with its error code, for the consumer, and
+    // wake up the supervisor in case the link is watched.
+    ses->rx_code = get_error();
+    InterlockedExchange(&ses->rx_fail, TRUE);
+    SetEvent(ses->rx_ready);
+    wake_super();
+}
+
+static void give_room(hwtt_session_t *ses, int full) {
+    // Wake up the reader of a ring that was full, as it stopped reading the
+    // link until the consumer made room: the poller thread, which left its
+    // socket out of the poll set, or the reader thread of the serial port.
+#if       (ETH == 1)
+    if (full == TRUE) {
+        AcquireSRWLockShared(&poll_lock);
+        wake_poll();
+        ReleaseSRWLockShared(&poll_lock);
+    }
+#else  // (ETH == 1)
+    if (full == TRUE && ses->rx_room != NULL) {
+        SetEvent(ses->rx_room);
+    }
+#endif // (ETH == 1)
+}
+
+#if       (ETH == 1)
+
+static void poll_thread(void) {
+    // Serve the registered sockets until none is left.
+    for (;;) {
+        // Take the wake socket and the sockets whose rings have room (a full
+        // one is polled again once the consumer takes bytes from it, which
+        // wakes up this thread).
+        WSAPOLLFD       fds[POLL_SET_SIZE] = {0};
+        hwtt_session_t *ses[POLL_SET_SIZE] = {0};
+        ULONG           n = 1;
+        AcquireSRWLockExclusive(&poll_lock);
+        if (poll_n == 0) {
+            closesocket(poll_wake);
+            WSACleanup();
+            poll_wake = INVALID_SOCKET;
+            poll_on   = FALSE;
+            ReleaseSRWLockExclusive(&poll_lock);
+            break;
+        }
+        fds[0].fd     = poll_wake;
+        fds[0].events = POLLRDNORM;
+        for (int i = 0; i < poll_n; i++) {
+            hwtt_session_t *s = poll_ses[i];
+            if (s->rx_head - s->rx_tail < RX_RING_SIZE) {
+                fds[n].fd     = s->s;
+                fds[n].events = POLLRDNORM;
+                ses[n]        = s;
+                n++;
+            }
+        }
+        ReleaseSRWLockExclusive(&poll_lock);
+
+        // Wait until any of them is readable, closed or failed, or until the
+        // set changes or a ring gets room, without any periodic wakeup.
+        int ret = WSAPoll(fds, n, POLL_NO_TIMEOUT);
+        if (ret <= 0) {
+            continue;
+        }
+        if (fds[0].revents != 0) {
+            drain_wake();
+        }
+
+        // Read the ready sockets that are still registered (their sessions
+        // cannot be closed meanwhile, as it requires the lock). A failed one
+        // is unregistered, as nothing else will arrive.
+        AcquireSRWLockExclusive(&poll_lock);
+        for (ULONG i = 1; i < n; i++) {
+            if (fds[i].revents == 0 || is_polled(ses[i]) == FALSE) {
+                continue;
+            }
+            ret = fill_ring(ses[i]);
+            if (ret != 0) {
+                fail_ring(ses[i]);
+                for (int j = 0; j < poll_n; j++) {
+                    if (poll_ses[j] == ses[i]) {
+                        poll_ses[j] = poll_ses[--poll_n];
+                        break;
+                    }
+                }
+            }
+        }
+        ReleaseSRWLockExclusive(&poll_lock);
+    }
+}
+
+static int add_poll(hwtt_session_t *ses) {
+    // Register the session, starting the poller thread with its wake socket if
+    // it is not running, or waking it up so that it polls the new socket.
+    int ret = 0;
+    AcquireSRWLockExclusive(&poll_lock);
+    if (poll_n == POLL_SET_SIZE - 1) {
+        ret = 1;
+    } else if (poll_on == FALSE) {
+        poll_wake = open_wake();
+        HANDLE thread = NULL;
+        if (poll_wake != INVALID_SOCKET) {
+            thread = CreateThread(NULL, 0, (void *)poll_thread, NULL, 0, NULL);
+        }
+        if (thread == NULL) {
+            if (poll_wake != INVALID_SOCKET) {
+                closesocket(poll_wake);
+                WSACleanup();
+                poll_wake = INVALID_SOCKET;
+            }
+            ret = 1;
+        } else {
+            CloseHandle(thread);
+            poll_ses[poll_n] = ses;
+            poll_n++;
+            poll_on = TRUE;
+        }
+    } else {
+        poll_ses[poll_n] = ses;
+        poll_n++;
+        wake_poll();
+    }
+    ReleaseSRWLockExclusive(&poll_lock);
+
+    return ret;
+}
+
+static void del_poll(hwtt_session_t *ses) {
+    // Unregister the session, if registered, and wake up the poller thread so
+    // that it stops polling its socket (or ends if none is left). Once the
+    // lock is released, the poller thread does not read it anymore.
+    AcquireSRWLockExclusive(&poll_lock);
+    for (int i = 0; i < poll_n; i++) {
+        if (poll_ses[i] == ses) {
+            poll_ses[i] = poll_ses[--poll_n];
+            wake_poll();
+            break;
+        }
+    }
+    ReleaseSRWLockExclusive(&poll_lock);
+}
+
+static int is_polled(hwtt_session_t *ses) {
+    // Tell if the session is registered. The lock must be held.
+    for (int i = 0; i < poll_n; i++) {
+        if (poll_ses[i] == ses) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static SOCKET open_wake(void) {
+    // Open the wake socket of the poller thread: a non-blocking UDP socket on
+    // the loopback interface connected to itself, so that a byte sent to it
+    // makes it readable. It takes its own reference of the TCP/IP stack, as
+    // the one of every link is released when the link is closed.
+    WSADATA wsaData = {0};
+    int ret = WSAStartup(WSA_VALUE, &wsaData);
+    if (ret != 0) {
+        return INVALID_SOCKET;
+    }
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) {
+        WSACleanup();
+
+        return INVALID_SOCKET;
+    }
+    struct sockaddr_in addr = {
+        .sin_family      = AF_INET,
+        .sin_port        = 0,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    int addr_len = sizeof(addr);
+    u_long non_blocking = TRUE;
+    ret  = bind(s, (struct sockaddr *)&addr, sizeof(addr));
+    ret |= getsockname(s, (struct sockaddr *)&addr, &addr_len);
+    ret |= connect(s, (struct sockaddr *)&addr, sizeof(addr));
+    ret |= ioctlsocket(s, FIONBIO, &non_blocking);
+    if (ret != 0) {
+        closesocket(s);
+        WSACleanup();
+
+        return INVALID_SOCKET;
+    }
+
+    return s;
+}
+
+static void wake_poll(void) {
+    // Wake up the poller thread, if running, by making its wake socket
+    // readable (the lock must be held). A send that does not fit is not
+    // needed, as the socket is already readable.
+    if (poll_wake != INVALID_SOCKET) {
+        const char wake = POLL_WAKE_BYTE;
+        send(poll_wake, &wake, SINGLE_CHAR_SIZE, 0);
+    }
+}
+
+static void drain_wake(void) {
+    // Discard every pending wake up of the poller thread.
+    char buf[DEF_SMA_BUF_SIZE] = {0};
+    while (recv(poll_wake, buf, sizeof(buf), 0) > 0) {
+        continue;
+    }
+}
+
+#endif // (ETH == 1)
+
+static DWORD get_error(void) {
+    // Get the error code of the last communications failure of this thread.
+    if (*coms == 'U') {
+        return GetLastError();
+    }
+
+    return WSAGetLastError();
+}
+
+static void set_error(DWORD code) {
+    // Set the error code of a communications failure for this thread, so that
+    // print_error() finds it.
+    if (*coms == 'U') {
+        SetLastError(code);
+    } else {
+        WSASetLastError(code);
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32
@@ -0,0 +1,283 @@
+// -----------------------------------------------------------------------------
+// SUPER_C
+//
+// - Supervisor thread, which sleeps until something happens: it is woken up by
+//   the moves and resizes of the console window, to forbid the full screen, and
+//   by the deadlines of the heartbeats and the failures of the links, which it
+//   checks while the user is reading a prompt or a question
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  "public.h"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   HEARTBEAT_REQ                                                     "\r"
+#define   MAX_WATCHES                                         (MAX_STATIONS + 1)
+
+#define   FULL_POLL_MS                                                        50
+
+// -------------------- Private data types declarations --------------------- //
+
+// -----------------------------------------------------------------------------
+// Link watched by the heartbeats while its session waits for the user
+// -----------------------------------------------------------------------------
+typedef struct watch {
+    hwtt_session_t *ses;                 // Watched session or NULL if free
+    ULONGLONG   due;                     // Tick count of the next heartbeat
+    int         lost;                    // TRUE if a heartbeat failed
+    int         busy;                    // TRUE while a heartbeat is sent
+} watch_t;
+
+// --------------- Public global data holders initializations --------------- //
+
+// -------------- Private global data holders initializations --------------- //
+
+static watch_t             watch[MAX_WATCHES] = {0};
+static SRWLOCK             watch_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE  watch_done = CONDITION_VARIABLE_INIT;
+static HANDLE              wake       = NULL;
+static HWND                cons_hdle  = NULL;
+
+// --------------------- Private functions declarations --------------------- //
+
+static void CALLBACK on_move(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+        LONG obj, LONG child, DWORD thread, DWORD ms);
+static void check_full(void);
+static DWORD beat_all(void);
+static int take_due(watch_t **due);
+static int beat_link(hwtt_session_t *ses);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+int init_super(void) {
+    // Create the event that wakes up the supervisor when the watches change.
+    wake = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (wake == NULL) {
+        return 1;
+    }
+
+    return 0;
+}
+
+void super_thread(void) {
+    // Be notified of every move or resize of the console window, which belongs
+    // to the console host process, instead of checking it periodically. If
+    // the hook is not available, check it every FULL_POLL_MS.
+    cons_hdle = GetConsoleWindow();
+    DWORD idProcess = 0;
+    GetWindowThreadProcessId(cons_hdle, &idProcess);
+    HWINEVENTHOOK hook = SetWinEventHook(EVENT_OBJECT_LOCATIONCHANGE,
+            EVENT_OBJECT_LOCATIONCHANGE, NULL, on_move, idProcess, 0,
+            WINEVENT_OUTOFCONTEXT);
+    check_full();
+
+    // Run this thread infinitely, sending the heartbeats that are due and then
+    // sleeping until the next one, a change of the watches, a failure of a
+    // link or a window event (whose callback is run while the messages are
+    // retrieved). Without watches nor events, this thread never wakes up.
+    for (;;) {
+        DWORD ms = beat_all();
+        if (hook == NULL && ms > FULL_POLL_MS) {
+            ms = FULL_POLL_MS;
+        }
+        DWORD nCount = (wake != NULL) ? 1 : 0;
+        MsgWaitForMultipleObjects(nCount, &wake, FALSE, ms, QS_ALLINPUT);
+        MSG msg = {0};
+        while (PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE) != FALSE) {
+            DispatchMessageA(&msg);
+        }
+        if (hook == NULL) {
+            check_full();
+        }
+    }
+}
+
+void watch_link(hwtt_session_t *ses) {
+    // Only open links are watched, and only if the heartbeats are configured
+    // and the supervisor is running.
+    if (HEARTBEAT_MS == 0 || wake == NULL || ses->link_up == FALSE) {
+        return;
+    }
+
+    // Take a free watch, with its first heartbeat after a whole period, and
+    // wake up the supervisor so that it waits for it.
+    AcquireSRWLockExclusive(&watch_lock);
+    for (int i = 0; i < MAX_WATCHES; i++) {
+        watch_t *w = &watch[i];
+        if (w->ses == NULL) {
+            w->ses  = ses;
+            w->due  = GetTickCount64() + HEARTBEAT_MS;
+            w->lost = FALSE;
+            w->busy = FALSE;
+            break;
+        }
+    }
+    ReleaseSRWLockExclusive(&watch_lock);
+    SetEvent(wake);
+}
+
+int unwatch_link(hwtt_session_t *ses) {
+    // Free the watch of the session, once its heartbeat in progress (if any)
+    // ends (the heartbeats of other sessions are not waited for), and wake up
+    // the supervisor so that it stops waiting for it.
+    if (wake == NULL) {
+        return 0;
+    }
+    int lost = FALSE;
+    AcquireSRWLockExclusive(&watch_lock);
+    for (int i = 0; i < MAX_WATCHES; i++) {
+        watch_t *w = &watch[i];
+        if (w->ses == ses) {
+            while (w->busy == TRUE) {
+                SleepConditionVariableSRW(&watch_done, &watch_lock, INFINITE,
+                        0);
+            }
+            lost   = w->lost;
+            w->ses = NULL;
+            break;
+        }
+    }
+    ReleaseSRWLockExclusive(&watch_lock);
+    SetEvent(wake);
+    if (lost == TRUE) {
+        return 1;
+    }
+
+    return 0;
+}
+
+void wake_super(void) {
+    // Wake up the supervisor, if it is running, so that it checks the links.
+    if (wake != NULL) {
+        SetEvent(wake);
+    }
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+static void CALLBACK on_move(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+        LONG obj, LONG child, DWORD thread, DWORD ms) {
+    // Check the console window when it is moved or resized (the events of its
+    // carets and other objects are ignored).
+    if (hwnd == cons_hdle && obj == OBJID_WINDOW) {
+        check_full();
+    }
+}
+
+static void check_full(void) {
+    // Check if the dimensions of the console are equals of the ones of the
+    // display resolution. If they are equal, it is because the program is
+    // running in full screen, which is not allowed, so the program is killed
+    // after prompting an error.
+    HWND desk_hdle = GetDesktopWindow();
+    RECT cons_rect = {0};
+    RECT desk_rect = {0};
+    GetWindowRect(cons_hdle, &cons_rect);
+    GetWindowRect(desk_hdle, &desk_rect);
+    if (    cons_rect.left   == desk_rect.left   &&
+            cons_rect.top    == desk_rect.top    &&
+            cons_rect.right  == desk_rect.right  &&
+            cons_rect.bottom == desk_rect.bottom) {
+        prompt_error(
+                "Unsupported window mode",
+                "Running this program in full screen is not allowed!"
+        );
+    }
+}
+
+static DWORD beat_all(void) {
+    // Send the heartbeats that are due without the lock, so that the sessions
+    // can take and free other watches meanwhile, marking as lost the links
+    // that do not answer.
+    watch_t *due[MAX_WATCHES] = {0};
+    int n_due = take_due(due);
+    int lost[MAX_WATCHES] = {0};
+    for (int i = 0; i < n_due; i++) {
+        lost[i] = beat_link(due[i]->ses);
+    }
+
+    // Hand the sent watches back, waking up the sessions that wait for them,
+    // and get the time until the next heartbeat (INFINITE if none).
+    DWORD ms = INFINITE;
+    AcquireSRWLockExclusive(&watch_lock);
+    ULONGLONG now = GetTickCount64();
+    for (int i = 0; i < n_due; i++) {
+        due[i]->lost = (lost[i] != 0);
+        due[i]->due  = now + HEARTBEAT_MS;
+        due[i]->busy = FALSE;
+    }
+    for (int i = 0; i < MAX_WATCHES; i++) {
+        watch_t *w = &watch[i];
+        if (w->ses == NULL || w->lost == TRUE) {
+            continue;
+        }
+        if (w->due <= now) {
+            ms = 0;
+        } else if (w->due - now < ms) {
+            ms = (DWORD)(w->due - now);
+        }
+    }
+    ReleaseSRWLockExclusive(&watch_lock);
+    if (n_due > 0) {
+        WakeAllConditionVariable(&watch_done);
+    }
+
+    return ms;
+}
+
+static int take_due(watch_t **due) {
+    // Mark as busy the watches whose heartbeat is due or whose link failed
+    // meanwhile, so that their sessions wait for them, and get them.
+    int n_due = 0;
+    AcquireSRWLockExclusive(&watch_lock);
+    ULONGLONG now = GetTickCount64();
+    for (int i = 0; i < MAX_WATCHES; i++) {
+        watch_t *w = &watch[i];
+        if (w->ses == NULL || w->lost == TRUE) {
+            continue;
+        }
+        if (now >= w->due || w->ses->rx_fail == TRUE) {
+            w->busy = TRUE;
+            due[n_due] = w;
+            n_due++;
+        }
+    }
+    ReleaseSRWLockExclusive(&watch_lock);
+
+    return n_due;
+}
+
+static int beat_link(hwtt_session_t *ses) {
+    // Check the link without blocking and, with ASCII responses, also that the
+    // PCBA answers a simple \r request before CONN_TIMEOUT_MS. Its session is
+    // waiting for the user meanwhile, so nothing else is using the link.
+    if (ses->rx_fail == TRUE) {
+        return 1;
+    }
+    int ret = check_coms(ses);
+    if (ret == 0 && ses->bin == FALSE) {
+        int    acked = FALSE;
+        size_t n_rcv = 0;
+        ret = exe_cmd(ses, HEARTBEAT_REQ, "", &acked, &n_rcv);
+    }
+
+    return ret;
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32
@@ -26,6 +26,9 @@
 #define   N_PROMPT_FIELDS                   sizeof(  prompt) / sizeof(  *prompt)
 #define   N_REQUEST_FIELDS                  sizeof( request) / sizeof( *request)
 #define   N_QUESTION_FIELDS                 sizeof(question) / sizeof(*question)
+#define   N_TIMEOUT_FIELDS                  sizeof( timeout) / sizeof( *timeout)
+#define   N_PAYLOAD_FIELDS                  sizeof( payload) / sizeof( *payload)
+#define   N_DOWNLOAD_FIELDS                 sizeof(download) / sizeof(*download)
 
 // -------------------- Private data types declarations --------------------- //
 
@@ -58,6 +61,33 @@ const char *question[] = {
     /* 05 */    " <- Is the voltage higher than 1,75 volts? [Y/N] : "
 };
 
+const DWORD   timeout[] = {
+    /* 00 */    0,
+    /* 01 */    0,
+    /* 02 */    0,
+    /* 03 */    10000,
+    /* 04 */    0,
+    /* 05 */    0
+};
+
+const int     payload[] = {
+    /* 00 */    PAYLOAD_TEXT,
+    /* 01 */    PAYLOAD_TEXT,
+    /* 02 */    PAYLOAD_TEXT,
+    /* 03 */    PAYLOAD_TEXT,
+    /* 04 */    PAYLOAD_TEXT,
+    /* 05 */    PAYLOAD_TEXT
+};
+
+const char *download[] = {
+    /* 00 */    "",
+    /* 01 */    "",
+    /* 02 */    "",
+    /* 03 */    "",
+    /* 04 */    "",
+    /* 05 */    ""
+};
+
 // -------------- Private global data holders initializations --------------- //
 
 // --------------------- Private functions declarations --------------------- //
@@ -82,12 +112,59 @@ static void __attribute__ ((unused)) cfg_check(void) {
 #if       N_TESTS > 100
 #error    "The number of tests cannot exceed 100!"
 #endif // N_TESTS > 100
+#if       PIPELINE_WINDOW < 0
+#error    "The pipelined requests window cannot be negative!"
+#endif // PIPELINE_WINDOW < 0
+#if       NEG_BAUD_RATE < 0
+#error    "The negotiated baud rate cannot be negative!"
+#endif // NEG_BAUD_RATE < 0
+#if       DL_CHUNK_SIZE < 1 || DL_WINDOW < 1
+#error    "The download chunk size and window must be positive!"
+#endif // DL_CHUNK_SIZE < 1 || DL_WINDOW < 1
+#if       BIN_FRAMES != 0 && BIN_FRAMES != 1
+#error    "The binary frames switch must be 0 or 1!"
+#endif // BIN_FRAMES != 0 && BIN_FRAMES != 1
+#if       PROBE_ECHOES < 0 || PROBE_SIZE < 1
+#error    "The probe echoes cannot be negative and its size must be positive!"
+#endif // PROBE_ECHOES < 0 || PROBE_SIZE < 1
+#if       PROBE_MAX_RTT_US < 0 || PROBE_MIN_RATE < 0
+#error    "The probe limits cannot be negative!"
+#endif // PROBE_MAX_RTT_US < 0 || PROBE_MIN_RATE < 0
+#if       HEARTBEAT_MS < 0
+#error    "The heartbeat period cannot be negative!"
+#endif // HEARTBEAT_MS < 0
+#if       PROFILE != 0 && PROFILE != 1
+#error    "The profiler switch must be 0 or 1!"
+#endif // PROFILE != 0 && PROFILE != 1
+#if       DASHBOARD_MS < 0
+#error    "The dashboard period cannot be negative!"
+#endif // DASHBOARD_MS < 0
+#if       SCAN_INPUT != 0 && SCAN_INPUT != 1
+#error    "The scanner input switch must be 0 or 1!"
+#endif // SCAN_INPUT != 0 && SCAN_INPUT != 1
+#if       SCAN_DELIM == '_' || SCAN_DELIM == '.' || SCAN_DELIM <= ' '
+#error    "The scanner delimiter cannot be a space, an underscore nor a dot!"
+#endif // SCAN_DELIM == '_' || SCAN_DELIM == '.' || SCAN_DELIM <= ' '
+#if       (SCAN_DELIM >= '0' && SCAN_DELIM <= '9') || \
+          (SCAN_DELIM >= 'A' && SCAN_DELIM <= 'Z') || \
+          (SCAN_DELIM >= 'a' && SCAN_DELIM <= 'z')
+#error    "The scanner delimiter cannot be an alphanumeric character!"
+#endif // SCAN_DELIM alphanumeric
+#if       DEF_TIMEOUT_MS < 1 || CONN_TIMEOUT_MS < 1
+#error    "The default timeouts must be positive!"
+#endif // DEF_TIMEOUT_MS < 1 || CONN_TIMEOUT_MS < 1
     static_assert(N_PROMPT_FIELDS   >= N_TESTS,
             "Misconfiguration in prompts array!");
     static_assert(N_REQUEST_FIELDS  >= N_TESTS,
             "Misconfiguration in requests array!");
     static_assert(N_QUESTION_FIELDS >= N_TESTS,
             "Misconfiguration in questions array!");
+    static_assert(N_TIMEOUT_FIELDS  >= N_TESTS,
+            "Misconfiguration in timeouts array!");
+    static_assert(N_PAYLOAD_FIELDS  >= N_TESTS,
+            "Misconfiguration in payloads array!");
+    static_assert(N_DOWNLOAD_FIELDS >= N_TESTS,
+            "Misconfiguration in downloads array!");
 }
 
 // -----------------------------------------------------------------------------
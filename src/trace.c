@@ -0,0 +1,551 @@
+// -----------------------------------------------------------------------------
+// TRACE_C
+//
+// - Index of the traceability CSV, keyed by batch number and serial number, to
+//   look up the history of a PCBA without reading the whole CSV
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  "public.h"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   CSV_LOCK_OFFSET_HIGH                                        0x7FFFFFFF
+#define   CSV_LOCK_LEN                                                         1
+
+#define   IDX_MAGIC                                                   "HWTTIDX1"
+#define   IDX_MAGIC_SIZE                                                       8
+#define   IDX_KEY_SIZE                                                        32
+#define   IDX_MIN_SLOTS                                                     4096
+#define   IDX_MAX_LOAD_NUM                                                     3
+#define   IDX_MAX_LOAD_DEN                                                     4
+
+#define   FNV_OFFSET_BASIS                                            0x811C9DC5
+#define   FNV_PRIME                                                   0x01000193
+
+#define   SCAN_BUF_SIZE                                                    65536
+#define   CSV_BN_FIELD                                                         2
+#define   CSV_SN_FIELD                                                         3
+#define   CSV_DATE_FIELD                                                       4
+#define   CSV_OK_FIELD                                                         5
+#define   CSV_CRC_FIELD                                                        6
+#define   CSV_MAX_TESTS                                                      100
+#define   CSV_MAX_FIELDS                     (CSV_CRC_FIELD + CSV_MAX_TESTS + 1)
+#define   CSV_CRC_BASE                                                        16
+
+#define   CSV_CRC_SEP_LEN                                                      2
+#define   CSV_HEADER_KEY                                                  "USER"
+
+#define   IDX_GROW                                                             2
+#define   IDX_FULL                                                             2
+
+#define   DWORD_BITS                                                          32
+
+// -------------------- Private data types declarations --------------------- //
+
+// -----------------------------------------------------------------------------
+// Header of the index file, followed by an open addressing hash table of slots
+// -----------------------------------------------------------------------------
+typedef struct idx_head {
+    char        magic[IDX_MAGIC_SIZE];   // IDX_MAGIC
+    DWORD       n_slots;                 // Number of slots (power of two)
+    DWORD       n_used;                  // Number of used slots
+    ULONGLONG   csv_len;                 // Length of the indexed CSV bytes
+} idx_head_t;
+
+// -----------------------------------------------------------------------------
+// Slot of the index file, with the history of one PCBA
+// -----------------------------------------------------------------------------
+typedef struct idx_slot {
+    DWORD       used;                    // TRUE if the slot is used
+    DWORD       hash;                    // Hash of the batch and serial numbers
+    char        bn[IDX_KEY_SIZE];        // PCBA batch number
+    char        sn[IDX_KEY_SIZE];        // PCBA serial number
+    trace_rec_t rec;                     // History of the PCBA
+} idx_slot_t;
+
+// -----------------------------------------------------------------------------
+// Field of a CSV row, without the quotes
+// -----------------------------------------------------------------------------
+typedef struct csv_field {
+    const char *ptr;                     // First character
+    size_t      len;                     // Number of characters
+} csv_field_t;
+
+// --------------- Public global data holders initializations --------------- //
+
+// -------------- Private global data holders initializations --------------- //
+
+// --------------------- Private functions declarations --------------------- //
+
+static HANDLE open_idx(void);
+static int sync_idx(HANDLE csv, HANDLE idx, HANDLE *map, idx_head_t **head);
+static int make_idx(HANDLE idx, idx_head_t *head, DWORD n_slots);
+static int grow_idx(HANDLE idx, HANDLE *map, idx_head_t **head);
+static int map_idx(HANDLE idx, HANDLE *map, idx_head_t **head);
+static void unmap_idx(HANDLE *map, idx_head_t **head);
+static int scan_csv(HANDLE csv, idx_head_t *head, ULONGLONG csv_len);
+static int add_line(idx_head_t *head, const char *line, size_t len);
+static idx_slot_t *find_slot(idx_head_t *head, const char *bn,
+        const char *sn);
+
+static ULONGLONG get_idx_len(DWORD n_slots);
+static int set_len(HANDLE h, ULONGLONG len);
+static DWORD get_hash(const char *bn, const char *sn);
+static int read_at(HANDLE h, ULONGLONG off, void *buf, DWORD len);
+static int write_at(HANDLE h, ULONGLONG off, const void *buf, DWORD len);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+int lock_csv(HANDLE csv) {
+    // Lock a byte far beyond the end of the traceability CSV, shared by all the
+    // stations and programs that append to it or update its index.
+    OVERLAPPED stOverlapped = {
+        .OffsetHigh = CSV_LOCK_OFFSET_HIGH
+    };
+    BOOL ret = LockFileEx(csv, LOCKFILE_EXCLUSIVE_LOCK, 0, CSV_LOCK_LEN, 0,
+            &stOverlapped);
+    if (ret == FALSE) {
+        return 1;
+    }
+
+    return 0;
+}
+
+void unlock_csv(HANDLE csv) {
+    // Unlock the traceability CSV.
+    OVERLAPPED stOverlapped = {
+        .OffsetHigh = CSV_LOCK_OFFSET_HIGH
+    };
+    UnlockFileEx(csv, 0, CSV_LOCK_LEN, 0, &stOverlapped);
+}
+
+int sync_trace(HANDLE csv) {
+    // Index the rows appended to the traceability CSV since the last time. The
+    // lock of the CSV must be held.
+    HANDLE idx = open_idx();
+    if (idx == INVALID_HANDLE_VALUE) {
+        return 1;
+    }
+    HANDLE      map  = NULL;
+    idx_head_t *head = NULL;
+    int ret = sync_idx(csv, idx, &map, &head);
+    unmap_idx(&map, &head);
+    CloseHandle(idx);
+
+    return ret;
+}
+
+int find_trace(const char *bn, const char *sn, trace_rec_t *rec) {
+    // Open the traceability CSV and its index (nothing is found if there is no
+    // CSV yet).
+    memset(rec, 0, sizeof(*rec));
+    char name[DEF_SMA_BUF_SIZE] = {0};
+    get_csv_name(name, "csv");
+    HANDLE csv = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ |
+            FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (csv == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    HANDLE idx = open_idx();
+    if (idx == INVALID_HANDLE_VALUE) {
+        CloseHandle(csv);
+
+        return 1;
+    }
+
+    // Catch up with the rows appended by other stations or programs and look
+    // up the PCBA, while holding the lock of the CSV.
+    int ret = lock_csv(csv);
+    if (ret == 0) {
+        HANDLE      map  = NULL;
+        idx_head_t *head = NULL;
+        ret = sync_idx(csv, idx, &map, &head);
+        if (ret == 0) {
+            const idx_slot_t *slot = find_slot(head, bn, sn);
+            if (slot->used == TRUE) {
+                *rec = slot->rec;
+            }
+        }
+        unmap_idx(&map, &head);
+        unlock_csv(csv);
+    }
+    CloseHandle(idx);
+    CloseHandle(csv);
+
+    return ret;
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+static HANDLE open_idx(void) {
+    // Open the index file next to the traceability CSV, creating it if needed.
+    char name[DEF_SMA_BUF_SIZE] = {0};
+    get_csv_name(name, "idx");
+    DWORD dwDesiredAccess = GENERIC_READ | GENERIC_WRITE;
+    DWORD dwShareMode     = FILE_SHARE_READ | FILE_SHARE_WRITE;
+
+    return CreateFileA(name, dwDesiredAccess, dwShareMode, NULL, OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+}
+
+static int sync_idx(HANDLE csv, HANDLE idx, HANDLE *map, idx_head_t **head) {
+    // Get the current lengths of the traceability CSV and of its index.
+    LARGE_INTEGER size     = {0};
+    LARGE_INTEGER idx_size = {0};
+    BOOL res = GetFileSizeEx(csv, &size);
+    if (res != FALSE) {
+        res = GetFileSizeEx(idx, &idx_size);
+    }
+    if (res == FALSE) {
+        return 1;
+    }
+
+    // Rebuild the index from scratch if it is new or damaged (also if its
+    // length does not match its slots), or if it indexes more bytes than the
+    // CSV has (so the CSV was replaced).
+    idx_head_t h = {0};
+    int ret = read_at(idx, 0, &h, sizeof(h));
+    if (    ret != 0 ||
+            memcmp(h.magic, IDX_MAGIC, IDX_MAGIC_SIZE) != 0 ||
+            h.n_slots < IDX_MIN_SLOTS ||
+            (h.n_slots & (h.n_slots - 1)) != 0 ||
+            (ULONGLONG)idx_size.QuadPart != get_idx_len(h.n_slots) ||
+            h.csv_len > (ULONGLONG)size.QuadPart) {
+        ret = make_idx(idx, &h, IDX_MIN_SLOTS);
+        if (ret != 0) {
+            return 1;
+        }
+    }
+
+    // Map the index, so that only the pages of the probed slots are read, and
+    // the changed ones are written back at once when it is unmapped. Then
+    // index the new rows, growing the index whenever it becomes too loaded.
+    ret = map_idx(idx, map, head);
+    while (ret == 0) {
+        ret = scan_csv(csv, *head, size.QuadPart);
+        if (ret != IDX_FULL) {
+            break;
+        }
+        ret = grow_idx(idx, map, head);
+    }
+    if (ret != 0) {
+        unmap_idx(map, head);
+    }
+
+    return ret;
+}
+
+static int make_idx(HANDLE idx, idx_head_t *head, DWORD n_slots) {
+    // Truncate the index file and extend it again with all the slots free
+    // (zeroed by the file system), with nothing of the CSV indexed.
+    memset(head, 0, sizeof(*head));
+    memcpy(head->magic, IDX_MAGIC, IDX_MAGIC_SIZE);
+    head->n_slots = n_slots;
+    int ret = set_len(idx, 0);
+    if (ret == 0) {
+        ret = set_len(idx, get_idx_len(n_slots));
+    }
+    if (ret != 0) {
+        return 1;
+    }
+
+    return write_at(idx, 0, head, sizeof(*head));
+}
+
+static int grow_idx(HANDLE idx, HANDLE *map, idx_head_t **head) {
+    // Mark the index as damaged while it grows, so that it is rebuilt from
+    // scratch if the program ends meanwhile, and extend it with a free table
+    // of more slots after the old one (zeroed by the file system).
+    DWORD n_old = (*head)->n_slots;
+    DWORD n_new = n_old * IDX_GROW;
+    (*head)->magic[0] = 0;
+    unmap_idx(map, head);
+    int ret = set_len(idx, get_idx_len(n_old + n_new));
+    if (ret == 0) {
+        ret = map_idx(idx, map, head);
+    }
+    if (ret != 0) {
+        return 1;
+    }
+
+    // Insert the used slots of the old table into the new one, instead of
+    // indexing the whole CSV again, and move the new one to the place of the
+    // old one.
+    idx_slot_t *slot  = (idx_slot_t *)(*head + 1);
+    idx_slot_t *grown = &slot[n_old];
+    DWORD mask = n_new - 1;
+    for (DWORD i = 0; i < n_old; i++) {
+        if (slot[i].used == FALSE) {
+            continue;
+        }
+        DWORD j = slot[i].hash & mask;
+        while (grown[j].used == TRUE) {
+            j = (j + 1) & mask;
+        }
+        grown[j] = slot[i];
+    }
+    memmove(slot, grown, (size_t)n_new * sizeof(idx_slot_t));
+    memcpy((*head)->magic, IDX_MAGIC, IDX_MAGIC_SIZE);
+    (*head)->n_slots = n_new;
+
+    // Drop the rest of the file after the new table.
+    unmap_idx(map, head);
+    ret = set_len(idx, get_idx_len(n_new));
+    if (ret == 0) {
+        ret = map_idx(idx, map, head);
+    }
+
+    return ret;
+}
+
+static int map_idx(HANDLE idx, HANDLE *map, idx_head_t **head) {
+    // Map the whole index file in memory for reading and writing.
+    *map = CreateFileMappingA(idx, NULL, PAGE_READWRITE, 0, 0, NULL);
+    if (*map == NULL) {
+        return 1;
+    }
+    *head = MapViewOfFile(*map, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (*head == NULL) {
+        CloseHandle(*map);
+        *map = NULL;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+static void unmap_idx(HANDLE *map, idx_head_t **head) {
+    // Write the changed pages of the index back to its file, before the lock
+    // of the CSV is released, and unmap it (if it is mapped).
+    if (*head != NULL) {
+        FlushViewOfFile(*head, 0);
+        UnmapViewOfFile(*head);
+        *head = NULL;
+    }
+    if (*map != NULL) {
+        CloseHandle(*map);
+        *map = NULL;
+    }
+}
+
+static int scan_csv(HANDLE csv, idx_head_t *head, ULONGLONG csv_len) {
+    // Read the CSV from the first byte not indexed, adding every complete line
+    // (a line being written is left for the next time). Return IDX_FULL if the
+    // index needs more slots.
+    char *buf = malloc(SCAN_BUF_SIZE);
+    if (buf == NULL) {
+        return 1;
+    }
+    int ret = 0;
+    while (ret == 0 && head->csv_len < csv_len) {
+        DWORD len = SCAN_BUF_SIZE;
+        if (csv_len - head->csv_len < len) {
+            len = csv_len - head->csv_len;
+        }
+        ret = read_at(csv, head->csv_len, buf, len);
+        if (ret != 0) {
+            break;
+        }
+        size_t beg = 0;
+        for (size_t i = 0; i < len && ret == 0; i++) {
+            if (buf[i] != '\n') {
+                continue;
+            }
+            ret = add_line(head, &buf[beg], i - beg);
+            if (ret == 0) {
+                beg = i + 1;
+            }
+        }
+
+        // Skip a line longer than the buffer, which is not a valid row.
+        if (beg == 0 && ret == 0) {
+            if (len < SCAN_BUF_SIZE) {
+                break;
+            }
+            beg = len;
+        }
+        head->csv_len += beg;
+    }
+    free(buf);
+
+    return ret;
+}
+
+static int add_line(idx_head_t *head, const char *line, size_t len) {
+    // Split the line in quoted fields separated by semicolons, ignoring it if
+    // it is not a valid row.
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    csv_field_t field[CSV_MAX_FIELDS] = {0};
+    int n_fields = 0;
+    for (size_t i = 0; i < len && n_fields < CSV_MAX_FIELDS; ) {
+        if (line[i] != '"') {
+            return 0;
+        }
+        const char *end = memchr(&line[i + 1], '"', len - i - 1);
+        if (end == NULL) {
+            return 0;
+        }
+        field[n_fields].ptr = &line[i + 1];
+        field[n_fields].len = end - &line[i + 1];
+        n_fields++;
+        i = end - line + 1;
+        if (i < len && line[i] != ';') {
+            return 0;
+        }
+        i++;
+    }
+    const char key[] = CSV_HEADER_KEY;
+    if (    n_fields <= CSV_OK_FIELD || (field[0].len == strlen(key) &&
+            memcmp(field[0].ptr, key, strlen(key)) == 0)) {
+        return 0;
+    }
+
+    // Ignore a torn row, whose CRC-32 (the last column, after the durations of
+    // the tests) does not match its previous columns.
+    if (n_fields > CSV_CRC_FIELD) {
+        const csv_field_t *f = &field[n_fields - 1];
+        char hex[DEF_SMA_BUF_SIZE] = {0};
+        snprintf(hex, sizeof(hex), "%.*s", (int)f->len, f->ptr);
+        size_t n = f->ptr - line - CSV_CRC_SEP_LEN;
+        if (strtoul(hex, NULL, CSV_CRC_BASE) != crc32(0, line, n)) {
+            return 0;
+        }
+    }
+
+    // Look up the PCBA.
+    char bn[IDX_KEY_SIZE] = {0};
+    char sn[IDX_KEY_SIZE] = {0};
+    snprintf(bn, sizeof(bn), "%.*s", (int)field[CSV_BN_FIELD].len,
+            field[CSV_BN_FIELD].ptr);
+    snprintf(sn, sizeof(sn), "%.*s", (int)field[CSV_SN_FIELD].len,
+            field[CSV_SN_FIELD].ptr);
+    idx_slot_t *slot = find_slot(head, bn, sn);
+
+    // Take a free slot for a new PCBA, if the index is not too loaded.
+    if (slot->used == FALSE) {
+        if (    (ULONGLONG)(head->n_used + 1) * IDX_MAX_LOAD_DEN >
+                (ULONGLONG)head->n_slots * IDX_MAX_LOAD_NUM) {
+            return IDX_FULL;
+        }
+        slot->used = TRUE;
+        slot->hash = get_hash(bn, sn);
+        memcpy(slot->bn, bn, sizeof(bn));
+        memcpy(slot->sn, sn, sizeof(sn));
+        head->n_used++;
+    }
+
+    // Update the history of the PCBA with this row (the last one is the most
+    // recent one).
+    slot->rec.n_runs++;
+    snprintf(slot->rec.date, sizeof(slot->rec.date), "%.*s",
+            (int)field[CSV_DATE_FIELD].len, field[CSV_DATE_FIELD].ptr);
+    snprintf(slot->rec.ok, sizeof(slot->rec.ok), "%.*s",
+            (int)field[CSV_OK_FIELD].len, field[CSV_OK_FIELD].ptr);
+
+    return 0;
+}
+
+static idx_slot_t *find_slot(idx_head_t *head, const char *bn,
+        const char *sn) {
+    // Probe the slots from the one of the hash until the PCBA or a free slot
+    // is found (there is always a free one, as the load is limited).
+    char key_bn[IDX_KEY_SIZE] = {0};
+    char key_sn[IDX_KEY_SIZE] = {0};
+    snprintf(key_bn, sizeof(key_bn), "%s", bn);
+    snprintf(key_sn, sizeof(key_sn), "%s", sn);
+    DWORD hash = get_hash(key_bn, key_sn);
+    DWORD mask = head->n_slots - 1;
+    idx_slot_t *slot = (idx_slot_t *)(head + 1);
+    for (DWORD i = hash & mask; ; i = (i + 1) & mask) {
+        if (    slot[i].used == FALSE || (slot[i].hash == hash &&
+                strcmp(slot[i].bn, key_bn) == 0 &&
+                strcmp(slot[i].sn, key_sn) == 0)) {
+            return &slot[i];
+        }
+    }
+}
+
+static ULONGLONG get_idx_len(DWORD n_slots) {
+    // Get the length of an index file with a number of slots.
+    return sizeof(idx_head_t) + (ULONGLONG)n_slots * sizeof(idx_slot_t);
+}
+
+static int set_len(HANDLE h, ULONGLONG len) {
+    // Truncate or extend a file to a length (the extended bytes are zeroed by
+    // the file system).
+    LARGE_INTEGER dist = {.QuadPart = len};
+    BOOL ret = SetFilePointerEx(h, dist, NULL, FILE_BEGIN);
+    if (ret != FALSE) {
+        ret = SetEndOfFile(h);
+    }
+    if (ret == FALSE) {
+        return 1;
+    }
+
+    return 0;
+}
+
+static DWORD get_hash(const char *bn, const char *sn) {
+    // Get the FNV-1a hash of the batch number and the serial number, including
+    // their null terminators.
+    DWORD hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i <= strlen(bn); i++) {
+        hash = (hash ^ (BYTE)bn[i]) * FNV_PRIME;
+    }
+    for (size_t i = 0; i <= strlen(sn); i++) {
+        hash = (hash ^ (BYTE)sn[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static int read_at(HANDLE h, ULONGLONG off, void *buf, DWORD len) {
+    // Read a whole buffer from an offset of a file.
+    OVERLAPPED stOverlapped = {
+        .Offset     = (DWORD)off,
+        .OffsetHigh = (DWORD)(off >> DWORD_BITS)
+    };
+    DWORD n_rd = 0;
+    BOOL ret = ReadFile(h, buf, len, &n_rd, &stOverlapped);
+    if (ret == FALSE || n_rd != len) {
+        return 1;
+    }
+
+    return 0;
+}
+
+static int write_at(HANDLE h, ULONGLONG off, const void *buf, DWORD len) {
+    // Write a whole buffer at an offset of a file.
+    OVERLAPPED stOverlapped = {
+        .Offset     = (DWORD)off,
+        .OffsetHigh = (DWORD)(off >> DWORD_BITS)
+    };
+    DWORD n_wr = 0;
+    BOOL ret = WriteFile(h, buf, len, &n_wr, &stOverlapped);
+    if (ret == FALSE || n_wr != len) {
+        return 1;
+    }
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32
@@ -27,13 +27,22 @@
 #define   MAX_COM_VALUE_NAME_LEN                                           32767
 #define   MAX_COM_DATA_LEN                                                   255
 
-#define   MIN_COM_PORT_LEN                                                     1
-#define   MAX_COM_PORT_LEN                                                     6
+#define   MIN_BAUD_NUM                                                       110
+#define   MAX_BAUD_NUM                                                   4000000
 
-#define   BAUDRATE                                                          9600
-#define   PARITY                                                        NOPARITY
 #define   DATA_BITS                                                            8
-#define   STOP_BITS                                                   ONESTOPBIT
+
+#define   RX_QUEUE_SIZE                                                    65536
+#define   TX_QUEUE_SIZE                                                     4096
+
+#define   NEG_BAUD_CMD                                                 "HWTT_B_"
+#define   NEG_BAUD_ACK                                                 "BAUD_OK"
+#define   NEG_SWITCH_MS                                                       50
+#define   NEG_CHECK_SIZE                                                    4096
+
+#define   US_IN_ONE_S                                                    1000000
+
+#define   READ_TIMEOUT_MS                                         (MAXDWORD - 1)
 
 // -------------------- Private data types declarations --------------------- //
 
@@ -43,25 +52,30 @@ const char coms[] = "UART";
 
 // -------------- Private global data holders initializations --------------- //
 
-static HANDLE h = 0;
-
 // --------------------- Private functions declarations --------------------- //
 
+static int get_dcb(hwtt_session_t *ses, DCB *dcb);
+static void wait_write(hwtt_session_t *ses, OVERLAPPED *ov);
+static void wait_read(hwtt_session_t *ses, OVERLAPPED *ov);
+static void close_port(hwtt_session_t *ses);
+static int neg_baud(hwtt_session_t *ses, DCB *dcb);
+static int set_baud(hwtt_session_t *ses, DCB *dcb, DWORD baud);
+
 // ---------------------- Public functions definitions ---------------------- //
 
-int init_coms(void) {
+int init_coms(hwtt_session_t *ses) {
     // Setup the communications.
-    write_header(stdout, report, "Serial Communications Setup");
+    write_header(ses->cmd, ses->report, "Serial Communications Setup");
 
     // Open the registry key that contains the subkey with the available
     // communications ports and print them. As it is a predefined key, it is not
     // necessary to close it afterwards.
     HKEY com = 0;
-    ret = RegOpenKeyA(HKEY_LOCAL_MACHINE, "HARDWARE\\DEVICEMAP\\SERIALCOMM",
-            &com);
+    LONG ret = RegOpenKeyA(HKEY_LOCAL_MACHINE,
+            "HARDWARE\\DEVICEMAP\\SERIALCOMM", &com);
     if (ret != ERROR_SUCCESS) {
-        output(stdout, report, " -> No COM port list was found!");
-        output(stdout, report, "\n");
+        output(ses->cmd, ses->report, " -> No COM port list was found!");
+        output(ses->cmd, ses->report, "\n");
     } else {
         DWORD dwIndex = 0;
         CHAR lpValueName[MAX_COM_VALUE_NAME_LEN] = {0};
@@ -73,116 +87,183 @@ int init_coms(void) {
                     NULL, NULL, lpData, &dwcbData);
             if (ret == ERROR_SUCCESS) {
                 if (dwIndex == 0) {
-                    output(stdout, report, " -> COM ports were found:");
-                    output(stdout, report, "\n");
-                    output(stdout, report, "\n");
+                    output(ses->cmd, ses->report, " -> COM ports were found:");
+                    output(ses->cmd, ses->report, "\n");
+                    output(ses->cmd, ses->report, "\n");
                 }
                 char item[DEF_BIG_BUF_SIZE] = {0};
                 sprintf(item, " -> %s", lpData);
-                output(stdout, report, item);
-                output(stdout, report, "\n");
+                output(ses->cmd, ses->report, item);
+                output(ses->cmd, ses->report, "\n");
             }
             dwIndex++;
         }
         if (--dwIndex == 0) {
-            output(stdout, report, " -> No COM ports were found!");
-            output(stdout, report, "\n");
+            output(ses->cmd, ses->report, " -> No COM ports were found!");
+            output(ses->cmd, ses->report, "\n");
         }
     }
-    output(stdout, report, "\n");
+    output(ses->cmd, ses->report, "\n");
 
     // Request the communications port used to connect to the tested PCBA.
     const char  uart_fie[] = " <- Serial communication port : ";
-    static char uart_dat[MAX_COM_PORT_LEN + NULL_TERMIN_SIZE] = {DEF_COM_PORT};
+    char       *uart_dat = ses->addr;
     size_t      uart_len = strlen(uart_dat);
-    input(stdout, report, uart_fie, uart_dat, uart_len, MIN_COM_PORT_LEN,
+    input(ses->cmd, ses->report, uart_fie, uart_dat, uart_len, MIN_COM_PORT_LEN,
             MAX_COM_PORT_LEN, alphnum);
+    output(ses->cmd, ses->report, "\n");
+
+    // Request the baud rate, the parity and the stop bits (the data bits are
+    // always 8).
+    const char  baud_fie[] = " <- Baud rate                 : ";
+    size_t      baud_len = strlen(ses->baud);
+    input(ses->cmd, ses->report, baud_fie, ses->baud, baud_len, MIN_BAUD_LEN,
+            MAX_BAUD_LEN, numbers);
+    const char  par_fie[]  = " <- Parity [N/E/O/M/S]        : ";
+    size_t      par_len = strlen(ses->parity);
+    input(ses->cmd, ses->report, par_fie, ses->parity, par_len, PARITY_LEN,
+            PARITY_LEN, PARITIES);
+    const char  stop_fie[] = " <- Stop bits [1/1.5/2]       : ";
+    size_t      stop_len = strlen(ses->stop);
+    input(ses->cmd, ses->report, stop_fie, ses->stop, stop_len, MIN_STOP_LEN,
+            MAX_STOP_LEN, num_dot);
+
+    // Check if the entered UART settings are valid.
+    output(ses->cmd, ses->report, " -> Checking UART settings .... ");
+    DCB stDCB = {0};
+    ret = get_dcb(ses, &stDCB);
+    if (ret != 0) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, "Invalid UART settings.");
 
-    // Open the selected communications port.
-    output(stdout, report, " -> Checking availability ..... ");
+        return 1;
+    }
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
+    output(ses->cmd, ses->report, "\n");
+
+    // Open the selected communications port for overlapped I/O, so that the
+    // reader thread and the writes do not wait for each other, with an event
+    // for each kind of operation.
+    output(ses->cmd, ses->report, " -> Checking availability ..... ");
     DWORD dwDesiredAccess = GENERIC_READ | GENERIC_WRITE;
-    h = CreateFileA(uart_dat, dwDesiredAccess, 0, NULL, OPEN_EXISTING, 0, NULL);
-    if (h == INVALID_HANDLE_VALUE) {
-        output(stdout, report, error_msg);
-        output(stdout, report, "\n");
-        print_error("COM port not available.");
-
-        return 1;
-    }
-    output(stdout, report, ok_msg);
-    output(stdout, report, "\n");
-    output(stdout, report, "\n");
-
-    // Setup the communications port.
-    output(stdout, report, " -> Performing UART setup ..... ");
-    DCB stDCB = {
-        .DCBlength = sizeof(DCB),
-        .BaudRate  = BAUDRATE,
-        .fBinary   = TRUE,
-        .Parity    = PARITY,
-        .ByteSize  = DATA_BITS,
-        .StopBits  = STOP_BITS
+    ses->h = CreateFileA(uart_dat, dwDesiredAccess, 0, NULL, OPEN_EXISTING,
+            FILE_FLAG_OVERLAPPED, NULL);
+    if (ses->h == INVALID_HANDLE_VALUE) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, "COM port not available.");
+
+        return 1;
+    }
+    ses->rx_ov = CreateEventA(NULL, TRUE, FALSE, NULL);
+    ses->tx_ov = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (ses->rx_ov == NULL || ses->tx_ov == NULL) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
+        close_port(ses);
+
+        return 1;
+    }
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
+    output(ses->cmd, ses->report, "\n");
+
+    // Setup the communications port, with driver queues big enough to hold
+    // long responses at high baud rates.
+    output(ses->cmd, ses->report, " -> Performing UART setup ..... ");
+    ret = SetupComm(ses->h, RX_QUEUE_SIZE, TX_QUEUE_SIZE);
+    if (ret != 0) {
+        ret = SetCommState(ses->h, &stDCB);
+    }
+    if (ret == 0) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
+        close_port(ses);
+
+        return 1;
+    }
+
+    // Make every read return as soon as at least one byte is available, with
+    // all the bytes that are already in the driver's buffer, and otherwise
+    // wait for it without a timeout of its own (the read is cancelled when the
+    // deadline of the session expires or the reader thread is stopped). The
+    // writes have no timeout either, as they are cancelled when the deadline
+    // expires too (like when the flow control holds them).
+    COMMTIMEOUTS stCommTimeouts = {
+        .ReadIntervalTimeout         = MAXDWORD,
+        .ReadTotalTimeoutMultiplier  = MAXDWORD,
+        .ReadTotalTimeoutConstant    = READ_TIMEOUT_MS
     };
-    ret = SetCommState(h, &stDCB);
+    ret = SetCommTimeouts(ses->h, &stCommTimeouts);
     if (ret == 0) {
-        output(stdout, report, error_msg);
-        output(stdout, report, "\n");
-        print_error(NULL);
-        CloseHandle(h);
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
+        close_port(ses);
 
         return 1;
     }
-    output(stdout, report, ok_msg);
-    output(stdout, report, "\n");
-    output(stdout, report, "\n");
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
+    output(ses->cmd, ses->report, "\n");
 
     // Discard the content that could exist prior to the program's execution in
     // the buffers of the serial port of the computer.
-    output(stdout, report, " -> Clearing client buffers ... ");
-    ret = PurgeComm(h, PURGE_RXABORT | PURGE_TXCLEAR | PURGE_TXABORT |
+    output(ses->cmd, ses->report, " -> Clearing client buffers ... ");
+    ret = PurgeComm(ses->h, PURGE_RXABORT | PURGE_TXCLEAR | PURGE_TXABORT |
             PURGE_RXCLEAR);
     if (ret == 0) {
-        output(stdout, report, error_msg);
-        output(stdout, report, "\n");
-        print_error(NULL);
-        CloseHandle(h);
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
+        close_port(ses);
 
         return 1;
     }
-    output(stdout, report, ok_msg);
-    output(stdout, report, "\n");
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
 
     // Discard the content that could exist prior to the program's execution in
     // the buffers of the serial port of the PCBA. To do this, an ENTER is sent
     // to it and the received response is ignored (but it must exist and end
-    // with _HWTT_TEST_END).
-    output(stdout, report, " -> Clearing server buffers ... ");
-    const char _hwtt_test_end[] = "_HWTT_TEST_END";
-    char buf[sizeof(_hwtt_test_end)] = {0};
-    size_t len = sizeof(buf) - NULL_TERMIN_SIZE;
-    ret = send_buf("\r", SINGLE_CHAR_SIZE);
-    do {
+    // with _HWTT_TEST_END before CONN_TIMEOUT_MS).
+    output(ses->cmd, ses->report, " -> Clearing server buffers ... ");
+    int acked = 0;
+    size_t n_rcv = 0;
+    ret = exe_cmd(ses, "\r", "", &acked, &n_rcv);
+    if (ret != 0) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
+        close_port(ses);
+
+        return 1;
+    }
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
+
+    // Propose a faster baud rate to the PCBA, if configured.
+    if (NEG_BAUD_RATE > 0 && NEG_BAUD_RATE != stDCB.BaudRate) {
+        ret = neg_baud(ses, &stDCB);
         if (ret != 0) {
-            output(stdout, report, error_msg);
-            output(stdout, report, "\n");
-            print_error(NULL);
-            CloseHandle(h);
+            close_port(ses);
 
             return 1;
         }
-        char new = 0;
-        ret = recv_buf(&new, 1);
-        shift_buf(buf, len, new);
-    } while (strcmp(buf, _hwtt_test_end) != 0);
-    output(stdout, report, ok_msg);
-    output(stdout, report, "\n");
+    }
 
     return 0;
 }
 
-int shut_coms(void) {
+int shut_coms(hwtt_session_t *ses) {
     // End the connection.
-    ret = CloseHandle(h);
+    BOOL ret = CloseHandle(ses->h);
+    ses->h = INVALID_HANDLE_VALUE;
+    close_port(ses);
     if (ret == 0) {
         return 1;
     }
@@ -190,30 +271,274 @@ int shut_coms(void) {
     return 0;
 }
 
-int send_buf(const char *buf, size_t len) {
-    // Send a buffer of len number of bytes.
+int check_coms(hwtt_session_t *ses) {
+    // Check that the serial port is still present (an unplugged USB adapter
+    // fails here). The pending received bytes are not purged, as the reader
+    // thread may be reading them.
+    DWORD   dwErrors = 0;
+    COMSTAT stComStat = {0};
+    BOOL ret = ClearCommError(ses->h, &dwErrors, &stComStat);
+    if (ret == FALSE) {
+        return 1;
+    }
+
+    return 0;
+}
+
+int send_buf(hwtt_session_t *ses, const char *buf, size_t len) {
+    // Send a buffer of len number of bytes. A write cancelled at the deadline
+    // of the session is a timeout.
+    OVERLAPPED stOverlapped = {.hEvent = ses->tx_ov};
     DWORD dwNumberOfBytesWritten = 0;
-    ret = WriteFile(h, buf, len, &dwNumberOfBytesWritten, NULL);
+    BOOL ret = WriteFile(ses->h, buf, len, NULL, &stOverlapped);
+    if (ret == FALSE && GetLastError() != ERROR_IO_PENDING) {
+        return 1;
+    }
     if (ret == FALSE) {
+        wait_write(ses, &stOverlapped);
+    }
+    ret = GetOverlappedResult(ses->h, &stOverlapped, &dwNumberOfBytesWritten,
+            TRUE);
+    if (ret == FALSE && GetLastError() != ERROR_OPERATION_ABORTED) {
         return 1;
     }
+    if (dwNumberOfBytesWritten < len) {
+        SetLastError(ERROR_TIMEOUT);
+
+        return COMS_TIMEOUT;
+    }
 
     return 0;
 }
 
-int recv_buf(char *buf, size_t len) {
-    // Receive a buffer of len number of bytes.
+int read_coms(hwtt_session_t *ses, char *buf, size_t len, size_t *n_rcv) {
+    // Read up to len number of bytes, which returns as soon as any arrives. A
+    // cancelled read is not a failure (it returns the bytes read until then).
+    OVERLAPPED stOverlapped = {.hEvent = ses->rx_ov};
     DWORD lpNumberOfBytesRead = 0;
-    ret = ReadFile(h, buf, len, &lpNumberOfBytesRead, NULL);
+    *n_rcv = 0;
+    BOOL ret = ReadFile(ses->h, buf, len, NULL, &stOverlapped);
+    if (ret == FALSE && GetLastError() != ERROR_IO_PENDING) {
+        return 1;
+    }
     if (ret == FALSE) {
+        wait_read(ses, &stOverlapped);
+    }
+    ret = GetOverlappedResult(ses->h, &stOverlapped, &lpNumberOfBytesRead,
+            TRUE);
+    if (ret == FALSE && GetLastError() != ERROR_OPERATION_ABORTED) {
         return 1;
     }
+    *n_rcv = lpNumberOfBytesRead;
 
     return 0;
 }
 
 // --------------------- Private functions definitions ---------------------- //
 
+static int get_dcb(hwtt_session_t *ses, DCB *dcb) {
+    // Get the serial port settings from the baud rate, the parity and the stop
+    // bits of the session, checking that they are valid.
+    long baud = atol(ses->baud);
+    if (baud < MIN_BAUD_NUM || baud > MAX_BAUD_NUM) {
+        return 1;
+    }
+    memset(dcb, 0, sizeof(*dcb));
+    dcb->DCBlength = sizeof(DCB);
+    dcb->BaudRate  = baud;
+    dcb->fBinary   = TRUE;
+    dcb->ByteSize  = DATA_BITS;
+           if (*ses->parity == 'N') {
+        dcb->Parity = NOPARITY;
+    } else if (*ses->parity == 'E') {
+        dcb->Parity = EVENPARITY;
+    } else if (*ses->parity == 'O') {
+        dcb->Parity = ODDPARITY;
+    } else if (*ses->parity == 'M') {
+        dcb->Parity = MARKPARITY;
+    } else if (*ses->parity == 'S') {
+        dcb->Parity = SPACEPARITY;
+    } else {
+        return 1;
+    }
+    dcb->fParity = (dcb->Parity != NOPARITY);
+           if (strcmp(ses->stop, "1") == 0) {
+        dcb->StopBits = ONESTOPBIT;
+    } else if (strcmp(ses->stop, "1.5") == 0) {
+        dcb->StopBits = ONE5STOPBITS;
+    } else if (strcmp(ses->stop, "2") == 0) {
+        dcb->StopBits = TWOSTOPBITS;
+    } else {
+        return 1;
+    }
+
+    return 0;
+}
+
+static void wait_write(hwtt_session_t *ses, OVERLAPPED *ov) {
+    // Wait for the pending write and cancel it when the deadline of the
+    // session expires.
+    DWORD ret = WaitForSingleObject(ov->hEvent, get_remaining(ses));
+    if (ret != WAIT_OBJECT_0) {
+        CancelIoEx(ses->h, ov);
+    }
+}
+
+static void wait_read(hwtt_session_t *ses, OVERLAPPED *ov) {
+    // Wait for the pending read and cancel it when the deadline of the session
+    // expires or, in the reader thread, when the thread is asked to stop (its
+    // room event is set then, and the other times it is set are ignored).
+    if (ses->rx_room == NULL) {
+        DWORD ret = WaitForSingleObject(ov->hEvent, get_remaining(ses));
+        if (ret != WAIT_OBJECT_0) {
+            CancelIoEx(ses->h, ov);
+        }
+
+        return;
+    }
+    HANDLE lpHandles[] = {ov->hEvent, ses->rx_room};
+    for (;;) {
+        DWORD ret = WaitForMultipleObjects(2, lpHandles, FALSE, INFINITE);
+        if (ret == WAIT_OBJECT_0) {
+            return;
+        }
+        if (ret != WAIT_OBJECT_0 + 1 || ses->rx_stop == TRUE) {
+            CancelIoEx(ses->h, ov);
+
+            return;
+        }
+    }
+}
+
+static void close_port(hwtt_session_t *ses) {
+    // Close the serial port, if still open, and its events.
+    if (ses->h != INVALID_HANDLE_VALUE) {
+        CloseHandle(ses->h);
+        ses->h = INVALID_HANDLE_VALUE;
+    }
+    if (ses->rx_ov != NULL) {
+        CloseHandle(ses->rx_ov);
+        ses->rx_ov = NULL;
+    }
+    if (ses->tx_ov != NULL) {
+        CloseHandle(ses->tx_ov);
+        ses->tx_ov = NULL;
+    }
+}
+
+static int neg_baud(hwtt_session_t *ses, DCB *dcb) {
+    // Propose the new baud rate through the reserved command, which the PCBA
+    // must acknowledge with BAUD_OK_HWTT_TEST_END before switching to it (any
+    // other response means that it keeps the current one).
+    output(ses->cmd, ses->report, "\n");
+    output(ses->cmd, ses->report, " -> Negotiating baud rate ..... ");
+    DWORD old = dcb->BaudRate;
+    char req[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(req, "%s%lu\r", NEG_BAUD_CMD, (DWORD)NEG_BAUD_RATE);
+    int acked = 0;
+    size_t n_rcv = 0;
+    int ret = exe_cmd(ses, req, NEG_BAUD_ACK, &acked, &n_rcv);
+    if (ret != 0) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        print_error(ses, NULL);
+
+        return 1;
+    }
+    if (acked == FALSE) {
+        output(ses->cmd, ses->report, "Not supported");
+        output(ses->cmd, ses->report, "\n");
+
+        return 0;
+    }
+
+    // Switch to the new baud rate and verify it with a timed \r round trip,
+    // going back to the previous one if it fails (as the PCBA does when it
+    // does not receive the verification).
+    ret = set_baud(ses, dcb, NEG_BAUD_RATE);
+    LARGE_INTEGER freq = {0};
+    LARGE_INTEGER beg  = {0};
+    LARGE_INTEGER end  = {0};
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&beg);
+    if (ret == 0) {
+        ret = exe_cmd(ses, "\r", "", &acked, &n_rcv);
+    }
+    QueryPerformanceCounter(&end);
+    if (ret != 0) {
+        output(ses->cmd, ses->report, error_msg);
+        output(ses->cmd, ses->report, "\n");
+        output(ses->cmd, ses->report, " -> Falling back .............. ");
+        ret = set_baud(ses, dcb, old);
+        if (ret == 0) {
+            ret = exe_cmd(ses, "\r", "", &acked, &n_rcv);
+        }
+        if (ret != 0) {
+            output(ses->cmd, ses->report, error_msg);
+            output(ses->cmd, ses->report, "\n");
+            print_error(ses, NULL);
+
+            return 1;
+        }
+    }
+    output(ses->cmd, ses->report, ok_msg);
+    output(ses->cmd, ses->report, "\n");
+
+    // Print the baud rate in use and, if it changed, the verification round
+    // trip and the throughput at the new baud rate, measured with a transfer
+    // of NEG_CHECK_SIZE bytes from the PCBA (a round trip of a few bytes is
+    // mostly latency), discounting that round trip.
+    LONGLONG us = (end.QuadPart - beg.QuadPart) * US_IN_ONE_S / freq.QuadPart;
+    if (us < 1) {
+        us = 1;
+    }
+    char msg[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(msg, " -> Baud rate in use .......... %lu", dcb->BaudRate);
+    output(ses->cmd, ses->report, msg);
+    output(ses->cmd, ses->report, "\n");
+    if (dcb->BaudRate == old) {
+        return 0;
+    }
+    sprintf(msg, " -> Round trip ................ %lli us", us);
+    output(ses->cmd, ses->report, msg);
+    output(ses->cmd, ses->report, "\n");
+    DWORD rate = 0;
+    ret = time_down(ses, NEG_CHECK_SIZE, (DWORD)us, &rate);
+    if (ret != 0) {
+        print_error(ses, NULL);
+
+        return 1;
+    }
+    if (rate > 0) {
+        sprintf(msg, " -> Throughput from PCBA ...... %lu B/s", rate);
+    } else {
+        sprintf(msg, " -> Throughput from PCBA ...... Not supported");
+    }
+    output(ses->cmd, ses->report, msg);
+    output(ses->cmd, ses->report, "\n");
+
+    return 0;
+}
+
+static int set_baud(hwtt_session_t *ses, DCB *dcb, DWORD baud) {
+    // Wait until everything is transmitted, change the baud rate, give the
+    // PCBA time to change it too and discard what was received meanwhile.
+    FlushFileBuffers(ses->h);
+    dcb->BaudRate = baud;
+    BOOL ret = SetCommState(ses->h, dcb);
+    if (ret == FALSE) {
+        return 1;
+    }
+    Sleep(NEG_SWITCH_MS);
+    ret = PurgeComm(ses->h, PURGE_RXABORT | PURGE_RXCLEAR);
+    if (ret == FALSE) {
+        return 1;
+    }
+    drop_ring(ses);
+
+    return 0;
+}
+
 // -----------------------------------------------------------------------------
 
 #endif // (UART == 1)
@@ -0,0 +1,394 @@
+// -----------------------------------------------------------------------------
+// WRITER_C
+//
+// - Background writer, which finalizes the TXT reports and appends the rows of
+//   the traceability CSV while the next PCBA is already being tested
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  "public.h"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   WRITER_QUEUE_SIZE                                                   16
+#define   WRITER_QUEUE_MASK                             (WRITER_QUEUE_SIZE - 1)
+
+#define   CSV_MAX_VERSIONS                                                    99
+
+// -------------------- Private data types declarations --------------------- //
+
+// -----------------------------------------------------------------------------
+// Cell of the bounded lock-free queue: its sequence number tells whether it is
+// free for the producer at that position or ready for the consumer
+// -----------------------------------------------------------------------------
+typedef struct write_cell {
+    volatile LONG seq;                   // Sequence number of the cell
+    write_job_t   job;                   // Stored job
+} write_cell_t;
+
+// --------------- Public global data holders initializations --------------- //
+
+// -------------- Private global data holders initializations --------------- //
+
+static write_cell_t queue[WRITER_QUEUE_SIZE] = {0};
+
+static volatile LONG enq_pos = 0;
+static volatile LONG deq_pos = 0;
+
+static HANDLE free_sem = NULL;
+static HANDLE used_sem = NULL;
+static HANDLE writer   = NULL;
+
+static volatile LONG stopped = FALSE;
+
+static const char csv_head[] = "\"USER\";\"COMP\";\"B/N\";\"S/N\";\"Time_Date"
+        "\";\"OK?\"";
+static const char csv_tail[] = ";\"CRC32\"\n";
+
+static void *volatile fail_msg = NULL;
+static volatile LONG  n_fail   = 0;
+
+static char csv_base[DEF_SMA_BUF_SIZE] = {0};
+
+// --------------------- Private functions declarations --------------------- //
+
+static BOOL WINAPI on_ctrl(DWORD dwCtrlType);
+static void writer_thread(void);
+static void put_job(const write_job_t *job);
+static void pop_writer(write_job_t *job);
+static void save_job(const write_job_t *job);
+static int add_row(const write_job_t *job);
+static void get_header(char *buf);
+static void pick_csv(void);
+static void put_fail(const char *msg);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+int init_writer(void) {
+    // Pick the traceability CSV whose columns match the ones of this build.
+    pick_csv();
+
+    // Mark every cell as free for the producer at its position, and create the
+    // semaphores that count the free and the used cells.
+    for (LONG i = 0; i < WRITER_QUEUE_SIZE; i++) {
+        queue[i].seq = i;
+    }
+    free_sem = CreateSemaphoreA(NULL, WRITER_QUEUE_SIZE, WRITER_QUEUE_SIZE,
+            NULL);
+    used_sem = CreateSemaphoreA(NULL, 0, WRITER_QUEUE_SIZE, NULL);
+    if (free_sem == NULL || used_sem == NULL) {
+        return 1;
+    }
+
+    // Start the writer thread, and save what it has queued if the program is
+    // ended with CTRL + C or by closing its window.
+    writer = CreateThread(NULL, 0, (void *)writer_thread, NULL, 0, NULL);
+    if (writer == NULL) {
+        return 1;
+    }
+    SetConsoleCtrlHandler(on_ctrl, TRUE);
+
+    return 0;
+}
+
+void get_csv_name(char *name, const char *ext) {
+    // Get the name of the picked traceability CSV (or of the first one, if
+    // none was picked yet) with the given extension.
+    if (*csv_base == 0) {
+        sprintf(name, "%s.%s", PCBA_VERSION, ext);
+    } else {
+        sprintf(name, "%s.%s", csv_base, ext);
+    }
+}
+
+void push_writer(const write_job_t *job) {
+    // Without writer thread (or once it is stopping), save the job right now.
+    if (writer == NULL || stopped == TRUE) {
+        if (job->report != NULL) {
+            save_job(job);
+        }
+
+        return;
+    }
+    put_job(job);
+}
+
+void show_writer(FILE *cmd) {
+    // Take the last failure published by the writer thread, if any.
+    LONG  n   = InterlockedExchange(&n_fail, 0);
+    char *msg = InterlockedExchangePointer(&fail_msg, NULL);
+    if (msg == NULL) {
+        return;
+    }
+    if (n < 1) {
+        n = 1;
+    }
+
+    // Print it with the number of failures since the last time.
+    write_header(cmd, NULL, "Background Saving Errors");
+    char buf[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(buf, " -> Failed savings : %li. The last one:", n);
+    output(cmd, NULL, buf);
+    output(cmd, NULL, "\n");
+    output(cmd, NULL, "\n");
+    output(cmd, NULL, " -> ");
+    output(cmd, NULL, msg);
+    output(cmd, NULL, "\n");
+    free(msg);
+}
+
+void shut_writer(FILE *cmd) {
+    // Queue an empty job, which stops the writer thread after all the previous
+    // ones (only once, even if several threads end the program at the same
+    // time), and wait until it finishes. Its handles are kept, as the program
+    // ends right after.
+    if (writer == NULL) {
+        return;
+    }
+    if (InterlockedExchange(&stopped, TRUE) == FALSE) {
+        write_job_t stop = {0};
+        put_job(&stop);
+    }
+    WaitForSingleObject(writer, INFINITE);
+
+    // Print the failures that were not shown yet.
+    if (cmd != NULL) {
+        show_writer(cmd);
+    }
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+static BOOL WINAPI on_ctrl(DWORD dwCtrlType) {
+    // Save the queued jobs before the program is ended by CTRL + C or by the
+    // closing of its window (other events keep their default handling).
+    if (dwCtrlType == CTRL_C_EVENT || dwCtrlType == CTRL_CLOSE_EVENT) {
+        kill_program();
+    }
+
+    return FALSE;
+}
+
+static void writer_thread(void) {
+    // Save the queued jobs until the empty one arrives.
+    for (;;) {
+        write_job_t job = {0};
+        pop_writer(&job);
+        if (job.report == NULL) {
+            break;
+        }
+        save_job(&job);
+    }
+}
+
+static void put_job(const write_job_t *job) {
+    // Wait for a free cell (only if the queue is full).
+    WaitForSingleObject(free_sem, INFINITE);
+
+    // Claim the next position, which is free thanks to the semaphore unless
+    // another producer claims it first, and publish the job in its cell.
+    LONG pos = enq_pos;
+    for (;;) {
+        write_cell_t *cell = &queue[pos & WRITER_QUEUE_MASK];
+        if (cell->seq == pos) {
+            LONG old = InterlockedCompareExchange(&enq_pos, pos + 1, pos);
+            if (old == pos) {
+                cell->job = *job;
+                InterlockedExchange(&cell->seq, pos + 1);
+                break;
+            }
+            pos = old;
+        } else {
+            pos = enq_pos;
+        }
+    }
+
+    // Wake up the writer thread.
+    ReleaseSemaphore(used_sem, 1, NULL);
+}
+
+static void pop_writer(write_job_t *job) {
+    // Wait for a used cell.
+    WaitForSingleObject(used_sem, INFINITE);
+
+    // Take the job of the next position and free its cell for the producer of
+    // the same position in the next lap.
+    LONG pos = deq_pos;
+    for (;;) {
+        write_cell_t *cell = &queue[pos & WRITER_QUEUE_MASK];
+        if (cell->seq == pos + 1) {
+            LONG old = InterlockedCompareExchange(&deq_pos, pos + 1, pos);
+            if (old == pos) {
+                *job = cell->job;
+                InterlockedExchange(&cell->seq, pos + WRITER_QUEUE_SIZE);
+                break;
+            }
+            pos = old;
+        } else {
+            pos = deq_pos;
+        }
+    }
+
+    // Let a blocked producer continue.
+    ReleaseSemaphore(free_sem, 1, NULL);
+}
+
+static void save_job(const write_job_t *job) {
+    // In the production mode, append the row to the traceability CSV and note
+    // it in the TXT report.
+    char msg[DEF_BIG_BUF_SIZE] = {0};
+    if (job->csv != NULL) {
+        int ret = add_row(job);
+        if (CloseHandle(job->csv) == FALSE) {
+            ret = 1;
+        }
+        output(NULL, job->report, "\n");
+        if (ret != 0) {
+            output(NULL, job->report, " -> Traceability CSV not updated!");
+            sprintf(msg, "The traceability CSV could not be updated with the r"
+                    "esults of \"%s\".", job->path);
+            put_fail(msg);
+        } else {
+            output(NULL, job->report, " -> Traceability CSV updated.");
+        }
+        output(NULL, job->report, "\n");
+    }
+
+    // Print an empty line that marks the end of the TXT report and close it.
+    write_header(NULL, job->report, "");
+    int ret = fclose(job->report);
+    if (ret != 0) {
+        sprintf(msg, "The TXT report \"%s\" could not be written.", job->temp);
+        put_fail(msg);
+
+        return;
+    }
+
+    // Insert the TXT report in the folder, after deleting an old one with the
+    // same name if exists.
+    ret = remove(job->path);
+    if (ret != 0 && errno == EACCES) {
+        sprintf(msg, "Old TXT report exists that could not be replaced. The cu"
+                "rrent TXT report was saved as \"%s\". Delete manually the old"
+                " one, rename the new one and move it to the \"reports\" folde"
+                "r.", job->temp);
+        put_fail(msg);
+
+        return;
+    }
+    ret = rename(job->temp, job->path);
+    if (ret != 0) {
+        sprintf(msg, "The TXT report could not be moved to \"%s\", so it was s"
+                "aved as \"%s\".", job->path, job->temp);
+        put_fail(msg);
+    }
+}
+
+static int add_row(const write_job_t *job) {
+    // Take the lock of the traceability CSV, so that only the first station or
+    // program that appends to it writes the header with the title of each
+    // column.
+    int err = lock_csv(job->csv);
+    if (err != 0) {
+        return 1;
+    }
+    DWORD n_wrt = 0;
+    LARGE_INTEGER size = {0};
+    BOOL ret = GetFileSizeEx(job->csv, &size);
+    if (ret != FALSE && size.QuadPart == 0) {
+        char head[CSV_ROW_SIZE] = {0};
+        get_header(head);
+        ret = WriteFile(job->csv, head, strlen(head), &n_wrt, NULL);
+    }
+
+    // Append the whole row with a single write, which the append-only handle
+    // places atomically at the end of the file.
+    if (ret != FALSE) {
+        ret = WriteFile(job->csv, job->row, strlen(job->row), &n_wrt, NULL);
+    }
+
+    // Update the index of the CSV with the new row (a failure here does not
+    // matter, as the index catches up with the CSV the next time).
+    if (ret != FALSE) {
+        sync_trace(job->csv);
+    }
+    unlock_csv(job->csv);
+    if (ret == FALSE) {
+        return 1;
+    }
+
+    return 0;
+}
+
+static void get_header(char *buf) {
+    // Get the header of the traceability CSV, with a duration column per test
+    // before the CRC-32.
+    int len = sprintf(buf, "%s", csv_head);
+    for (int i = 0; i < N_TESTS; i++) {
+        len += sprintf(&buf[len], ";\"T%02i_MS\"", i);
+    }
+    sprintf(&buf[len], "%s", csv_tail);
+}
+
+static void pick_csv(void) {
+    // Take the first traceability CSV (<HW>.csv, then <HW>_v2.csv and so on)
+    // that does not exist yet, is empty or starts with the header of this
+    // build, so that the rows of a build with other columns (other tests or an
+    // older program) are never mixed with the ones of this build.
+    char head[CSV_ROW_SIZE] = {0};
+    get_header(head);
+    DWORD len = strlen(head);
+    for (int v = 1; v <= CSV_MAX_VERSIONS; v++) {
+        if (v == 1) {
+            sprintf(csv_base, "%s", PCBA_VERSION);
+        } else {
+            sprintf(csv_base, "%s_v%i", PCBA_VERSION, v);
+        }
+        char name[DEF_SMA_BUF_SIZE] = {0};
+        sprintf(name, "%s.csv", csv_base);
+        HANDLE csv = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ |
+                FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                NULL);
+        if (csv == INVALID_HANDLE_VALUE) {
+            break;
+        }
+        char  line[CSV_ROW_SIZE] = {0};
+        DWORD n_rd = 0;
+        BOOL  ret = ReadFile(csv, line, len, &n_rd, NULL);
+        CloseHandle(csv);
+        if (ret != FALSE && (n_rd == 0 ||
+                (n_rd == len && memcmp(line, head, len) == 0))) {
+            break;
+        }
+    }
+}
+
+static void put_fail(const char *msg) {
+    // Publish a failure for the next screen, replacing the previous one if it
+    // was not shown yet.
+    size_t len = strlen(msg) + NULL_TERMIN_SIZE;
+    char *new = malloc(len);
+    if (new != NULL) {
+        memcpy(new, msg, len);
+    }
+    char *old = InterlockedExchangePointer(&fail_msg, new);
+    free(old);
+    InterlockedIncrement(&n_fail);
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32
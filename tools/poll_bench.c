@@ -0,0 +1,471 @@
+// -----------------------------------------------------------------------------
+// POLL_BENCH_C
+//
+// - Loopback benchmark of the reader of the Ethernet links: a fake PCBA
+//   responder serves a number of boards (500 by default) and a session thread
+//   per board runs its tests against it, while the links are drained by the
+//   poller thread of reader.c (poll) or, as before it, by a reader thread per
+//   board (threads). The aggregate tests per second and the per-test latency
+//   percentiles are printed
+//
+// - Build (MinGW-w64), from the root of the repository:
+//
+//   gcc -O2 -DWIN32 tools/poll_bench.c -o poll_bench.exe -lws2_32
+//
+// - Usage:
+//
+//   poll_bench [boards] [tests per board] [poll | threads]
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  <winsock2.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  "../src/config.h"
+
+// The real reader is built in, with room in its poll set for every board.
+#undef    MAX_STATIONS
+#define   MAX_STATIONS                                                       512
+#include  "../src/reader.c"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   DEF_BOARDS                                                         500
+#define   DEF_TESTS                                                          200
+#define   TEST_TIMEOUT_MS                                                   5000
+#define   THREAD_STACK_SIZE                                                65536
+
+#define   CMD_SIZE                                                             6
+#define   RESP_PAYLOAD  "Lorem ipsum dolor sit amet, consectetur adipiscing\r\n"
+#define   TAIL_LEN                    (sizeof(HWTT_TEST_END) - NULL_TERMIN_SIZE)
+#define   RESP_BUF_SIZE                                                      256
+
+#define   PERCENT                                                            100
+#define   P50                                                                 50
+#define   P99                                                                 99
+
+// -------------------- Private data types declarations --------------------- //
+
+// -----------------------------------------------------------------------------
+// Simulated board: its test session, the thread that runs it and the latencies
+// of its tests
+// -----------------------------------------------------------------------------
+typedef struct bench_board {
+    hwtt_session_t ses;                  // Test session of the board
+    HANDLE      thread;                  // Session thread
+    int         n_tests;                 // Tests to be run
+    int         n_ok;                    // Tests answered in time
+    LONGLONG   *lat;                     // Latency of each test (QPC ticks)
+} bench_board_t;
+
+// -----------------------------------------------------------------------------
+// Connection of the fake PCBA responder, with its unfinished command
+// -----------------------------------------------------------------------------
+typedef struct bench_peer {
+    SOCKET      s;                       // Accepted socket
+    char        cmd[CMD_SIZE];           // Bytes of the unfinished command
+    size_t      n_cmd;                   // Number of them
+} bench_peer_t;
+
+// --------------- Public global data holders initializations --------------- //
+
+const char coms[] = "ETH";
+
+// -------------- Private global data holders initializations --------------- //
+
+static SOCKET listener = INVALID_SOCKET;
+static int    n_boards = DEF_BOARDS;
+static HANDLE start    = NULL;
+
+// --------------------- Private functions declarations --------------------- //
+
+static int open_listener(struct sockaddr_in *addr);
+static void responder_thread(void);
+static int serve_peer(bench_peer_t *peer);
+static int open_board(bench_board_t *b, const struct sockaddr_in *addr,
+        int threads);
+static void board_thread(bench_board_t *b);
+static void bench_reader(hwtt_session_t *ses);
+static int run_test(hwtt_session_t *ses, int num);
+static int cmp_lat(const void *a, const void *b);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+int main(int argc, char *argv[]) {
+    // Take the arguments, if given.
+    int n_tests = DEF_TESTS;
+    int threads = FALSE;
+    if (argc > 1) {
+        n_boards = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        n_tests = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        threads = (strcmp(argv[3], "threads") == 0);
+    }
+    if (n_boards < 1 || n_boards > MAX_STATIONS || n_tests < 1) {
+        fprintf(stderr, "Usage: poll_bench [1-%i boards] [tests per board] "
+                "[poll | threads]\n", MAX_STATIONS);
+
+        return 1;
+    }
+
+    // Start the fake PCBA responder.
+    WSADATA wsaData = {0};
+    struct sockaddr_in addr = {0};
+    int ret = WSAStartup(WSA_VALUE, &wsaData);
+    if (ret != 0 || open_listener(&addr) != 0) {
+        fprintf(stderr, "The responder could not be opened.\n");
+
+        return 1;
+    }
+    HANDLE responder = CreateThread(NULL, 0, (void *)responder_thread, NULL,
+            0, NULL);
+    start = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (responder == NULL || start == NULL) {
+        fprintf(stderr, "The responder could not be started.\n");
+
+        return 1;
+    }
+
+    // Connect every board and start its session thread, which waits for the
+    // others before testing.
+    bench_board_t *boards = calloc(n_boards, sizeof(bench_board_t));
+    if (boards == NULL) {
+        return 1;
+    }
+    for (int i = 0; i < n_boards; i++) {
+        boards[i].n_tests = n_tests;
+        boards[i].lat     = calloc(n_tests, sizeof(LONGLONG));
+        ret = (boards[i].lat == NULL);
+        if (ret == 0) {
+            ret = open_board(&boards[i], &addr, threads);
+        }
+        if (ret == 0) {
+            boards[i].thread = CreateThread(NULL, THREAD_STACK_SIZE,
+                    (void *)board_thread, &boards[i],
+                    STACK_SIZE_PARAM_IS_A_RESERVATION, NULL);
+            ret = (boards[i].thread == NULL);
+        }
+        if (ret != 0) {
+            fprintf(stderr, "The board %i could not be started.\n", i);
+
+            return 1;
+        }
+    }
+
+    // Run all the boards at once and wait for them.
+    LARGE_INTEGER freq = {0};
+    LARGE_INTEGER t0   = {0};
+    LARGE_INTEGER t1   = {0};
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t0);
+    SetEvent(start);
+    for (int i = 0; i < n_boards; i++) {
+        WaitForSingleObject(boards[i].thread, INFINITE);
+    }
+    QueryPerformanceCounter(&t1);
+
+    // Close the links, which ends the responder once all of them are gone.
+    for (int i = 0; i < n_boards; i++) {
+        shutdown(boards[i].ses.s, SD_BOTH);
+        shut_reader(&boards[i].ses);
+        closesocket(boards[i].ses.s);
+        CloseHandle(boards[i].thread);
+    }
+    WaitForSingleObject(responder, INFINITE);
+
+    // Gather the latencies of the answered tests and print the results.
+    LONGLONG *lat  = calloc((size_t)n_boards * n_tests, sizeof(LONGLONG));
+    size_t    n_ok = 0;
+    if (lat == NULL) {
+        return 1;
+    }
+    for (int i = 0; i < n_boards; i++) {
+        memcpy(&lat[n_ok], boards[i].lat, boards[i].n_ok * sizeof(LONGLONG));
+        n_ok += boards[i].n_ok;
+    }
+    qsort(lat, n_ok, sizeof(LONGLONG), cmp_lat);
+    double secs = (double)(t1.QuadPart - t0.QuadPart) / freq.QuadPart;
+    double ms   = 1000.0 / freq.QuadPart;
+    printf("Reader      : %s\n", threads ? "thread per board" : "poller");
+    printf("Boards      : %i\n", n_boards);
+    printf("Tests       : %zu of %zu answered\n", n_ok,
+            (size_t)n_boards * n_tests);
+    printf("Elapsed     : %.3f s\n", secs);
+    printf("Throughput  : %.0f tests/s\n", n_ok / secs);
+    if (n_ok > 0) {
+        printf("Latency p50 : %.3f ms\n", lat[n_ok * P50 / PERCENT] * ms);
+        printf("Latency p99 : %.3f ms\n", lat[n_ok * P99 / PERCENT] * ms);
+        printf("Latency max : %.3f ms\n", lat[n_ok - 1] * ms);
+    }
+
+    return (n_ok == (size_t)n_boards * n_tests) ? 0 : 1;
+}
+
+// Stubs of the functions of the program used by the reader.
+
+DWORD get_remaining(hwtt_session_t *ses) {
+    // Get the milliseconds left until the deadline, or 0 if it has expired.
+    ULONGLONG now = GetTickCount64();
+    if (now >= ses->deadline) {
+        return 0;
+    }
+
+    return ses->deadline - now;
+}
+
+void set_deadline(hwtt_session_t *ses, DWORD ms) {
+    // Set the instant when the communications of the session must end.
+    ses->deadline = GetTickCount64() + ms;
+}
+
+void show_frame(FILE *cmd) {
+    // Nothing is shown.
+}
+
+int read_coms(hwtt_session_t *ses, char *buf, size_t len, size_t *n_rcv) {
+    // Read up to len number of bytes, blocking until they arrive (the poller
+    // thread only reads a readable socket). A graceful close of the connection
+    // is a failure, as nothing else will arrive.
+    *n_rcv = 0;
+    int ret = recv(ses->s, buf, len, 0);
+    if (ret == SOCKET_ERROR) {
+        return 1;
+    }
+    if (ret == 0) {
+        WSASetLastError(WSAECONNRESET);
+
+        return 1;
+    }
+    *n_rcv = ret;
+
+    return 0;
+}
+
+void wake_super(void) {
+    // There is no supervisor.
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+static int open_listener(struct sockaddr_in *addr) {
+    // Listen on an ephemeral port of the loopback interface.
+    listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET) {
+        return 1;
+    }
+    int addr_len = sizeof(*addr);
+    addr->sin_family      = AF_INET;
+    addr->sin_port        = 0;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int ret = bind(listener, (struct sockaddr *)addr, sizeof(*addr));
+    ret |= getsockname(listener, (struct sockaddr *)addr, &addr_len);
+    ret |= listen(listener, SOMAXCONN);
+
+    return (ret != 0);
+}
+
+static void responder_thread(void) {
+    // Serve all the boards from a single thread, accepting them until all are
+    // connected and answering their commands until all of them are closed.
+    WSAPOLLFD    *fds   = calloc(n_boards + 1, sizeof(WSAPOLLFD));
+    bench_peer_t *peers = calloc(n_boards + 1, sizeof(bench_peer_t));
+    if (fds == NULL || peers == NULL) {
+        exit(1);
+    }
+    int n_acc  = 0;
+    int n_live = 0;
+    while (n_acc < n_boards || n_live > 0) {
+        ULONG n = 0;
+        if (n_acc < n_boards) {
+            fds[n].fd     = listener;
+            fds[n].events = POLLRDNORM;
+            n++;
+        }
+        for (int i = 0; i < n_live; i++) {
+            fds[n].fd     = peers[i].s;
+            fds[n].events = POLLRDNORM;
+            n++;
+        }
+        int ret = WSAPoll(fds, n, POLL_NO_TIMEOUT);
+        if (ret <= 0) {
+            continue;
+        }
+
+        // Serve the ready peers, from the last one, so that a closed one can
+        // be replaced by the last of the set.
+        int first = (n_acc < n_boards);
+        for (int i = n_live - 1; i >= 0; i--) {
+            if (fds[first + i].revents == 0) {
+                continue;
+            }
+            ret = serve_peer(&peers[i]);
+            if (ret != 0) {
+                closesocket(peers[i].s);
+                peers[i] = peers[--n_live];
+            }
+        }
+        if (first == TRUE && fds[0].revents != 0) {
+            SOCKET s = accept(listener, NULL, NULL);
+            if (s != INVALID_SOCKET) {
+                int on = TRUE;
+                setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *)&on,
+                        sizeof(on));
+                memset(&peers[n_live], 0, sizeof(bench_peer_t));
+                peers[n_live].s = s;
+                n_live++;
+                n_acc++;
+            }
+        }
+    }
+    closesocket(listener);
+    free(fds);
+    free(peers);
+}
+
+static int serve_peer(bench_peer_t *peer) {
+    // Answer every T_XX command received with a text line and the end sequence
+    // of a PASS, failing if the connection is closed.
+    char buf[DEF_SMA_BUF_SIZE] = {0};
+    int  ret = recv(peer->s, buf, sizeof(buf), 0);
+    if (ret <= 0) {
+        return 1;
+    }
+    for (int i = 0; i < ret; i++) {
+        if (buf[i] != '\r') {
+            if (peer->n_cmd < CMD_SIZE - NULL_TERMIN_SIZE) {
+                peer->cmd[peer->n_cmd++] = buf[i];
+            }
+            continue;
+        }
+        peer->cmd[peer->n_cmd] = '\0';
+        peer->n_cmd = 0;
+        char resp[RESP_BUF_SIZE] = {0};
+        int  len = sprintf(resp, "%sP_%s%s", RESP_PAYLOAD, &peer->cmd[2],
+                HWTT_TEST_END);
+        if (send(peer->s, resp, len, 0) != len) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int open_board(bench_board_t *b, const struct sockaddr_in *addr,
+        int threads) {
+    // Connect the board to the responder and start draining its link, with
+    // the poller thread or with a reader thread of its own.
+    hwtt_session_t *ses = &b->ses;
+    ses->s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (ses->s == INVALID_SOCKET) {
+        return 1;
+    }
+    int on  = TRUE;
+    int ret = connect(ses->s, (struct sockaddr *)addr, sizeof(*addr));
+    ret |= setsockopt(ses->s, IPPROTO_TCP, TCP_NODELAY, (char *)&on,
+            sizeof(on));
+    if (ret != 0) {
+        return 1;
+    }
+    ses->link_up = TRUE;
+    if (threads == FALSE) {
+        return init_reader(ses);
+    }
+    ses->rx_ready  = CreateEventA(NULL, FALSE, FALSE, NULL);
+    ses->rx_room   = CreateEventA(NULL, FALSE, FALSE, NULL);
+    ses->rx_thread = CreateThread(NULL, THREAD_STACK_SIZE,
+            (void *)bench_reader, ses, STACK_SIZE_PARAM_IS_A_RESERVATION, NULL);
+    if (ses->rx_ready == NULL || ses->rx_room == NULL ||
+            ses->rx_thread == NULL) {
+        return 1;
+    }
+
+    return 0;
+}
+
+static void board_thread(bench_board_t *b) {
+    // Run the tests of the board, noting the latency of each one, from the
+    // command sent to its end sequence received.
+    WaitForSingleObject(start, INFINITE);
+    for (int i = 0; i < b->n_tests; i++) {
+        LARGE_INTEGER t0 = {0};
+        LARGE_INTEGER t1 = {0};
+        QueryPerformanceCounter(&t0);
+        int ret = run_test(&b->ses, i % N_TESTS);
+        if (ret != 0) {
+            break;
+        }
+        QueryPerformanceCounter(&t1);
+        b->lat[b->n_ok++] = t1.QuadPart - t0.QuadPart;
+    }
+}
+
+static void bench_reader(hwtt_session_t *ses) {
+    // Drain the socket like the reader thread of a serial port, which is how
+    // every link was drained before the poller thread.
+    while (ses->rx_stop == FALSE) {
+        if (ses->rx_head - ses->rx_tail == RX_RING_SIZE) {
+            WaitForSingleObject(ses->rx_room, INFINITE);
+            continue;
+        }
+        int ret = fill_ring(ses);
+        if (ret != 0) {
+            fail_ring(ses);
+            break;
+        }
+    }
+}
+
+static int run_test(hwtt_session_t *ses, int num) {
+    // Send the command of a test and take the bytes of its response from the
+    // ring buffer until the end sequence arrives.
+    char cmd[CMD_SIZE + NULL_TERMIN_SIZE] = {0};
+    int  len = sprintf(cmd, "T_%02i\r", num);
+    set_deadline(ses, TEST_TIMEOUT_MS);
+    if (send(ses->s, cmd, len, 0) != len) {
+        return 1;
+    }
+    const char tail[] = HWTT_TEST_END;
+    size_t state = 0;
+    while (state < TAIL_LEN) {
+        char   buf[RESP_BUF_SIZE] = {0};
+        size_t n_rcv = 0;
+        int ret = recv_buf(ses, buf, sizeof(buf), &n_rcv);
+        if (ret != 0) {
+            return ret;
+        }
+        for (size_t i = 0; i < n_rcv && state < TAIL_LEN; i++) {
+            state = (buf[i] == tail[state]) ? state + 1 :
+                    (buf[i] == tail[0]);
+        }
+    }
+
+    return 0;
+}
+
+static int cmp_lat(const void *a, const void *b) {
+    // Compare two latencies, for sorting them in ascending order.
+    LONGLONG x = *(const LONGLONG *)a;
+    LONGLONG y = *(const LONGLONG *)b;
+
+    return (x > y) - (x < y);
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32
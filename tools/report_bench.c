@@ -0,0 +1,244 @@
+// -----------------------------------------------------------------------------
+// REPORT_BENCH_C
+//
+// - Benchmark of the writes of a TXT report: the same report is written
+//   through the output functions of io.c as before the buffered writer (an
+//   unbuffered stream, with every received byte printed on its own) and as now
+//   (a full buffer of 64 KiB, with the received bytes printed per read and a
+//   checkpoint after each test). The WriteFile calls per report are taken from
+//   the I/O counters of the process
+//
+// - Build (MinGW-w64), from the root of the repository:
+//
+//   gcc -O2 -DWIN32 tools/report_bench.c -o report_bench.exe
+//
+// - Usage:
+//
+//   report_bench [tests] [response bytes per test] [bytes per read]
+//
+// -----------------------------------------------------------------------------
+// Copyright (c) 2023 Jorge Botana Mtz. de Ibarreta
+//
+// This source code is distributed under the terms of the MIT License. For more
+// information, please see the LICENSE.txt file or refer to the following link:
+//
+//                                           https://opensource.org/license/mit/
+// -----------------------------------------------------------------------------
+
+#ifndef   WIN32
+#error    "This program is targeted to systems running a Microsoft Windows OS!"
+#else  // WIN32
+
+// ------------------------ Private headers includes ------------------------ //
+
+#include  <io.h>
+#include  <stdlib.h>
+#include  <string.h>
+
+// The real output functions are built in.
+#include  "../src/io.c"
+
+// ---------------------- Private preprocessor macros ----------------------- //
+
+#define   DEF_RESP_SIZE                                                     2048
+#define   DEF_READ_SIZE                                                     1460
+#define   REPORT_BUF_SIZE                                                  65536
+#define   LINE_LEN                                                            64
+
+#define   BENCH_FILE                                          "report_bench.txt"
+
+// -------------------- Private data types declarations --------------------- //
+
+// -----------------------------------------------------------------------------
+// Counts of the writing of a report
+// -----------------------------------------------------------------------------
+typedef struct bench_count {
+    ULONGLONG   writes;                  // WriteFile calls
+    ULONGLONG   bytes;                   // Written bytes
+    int         commits;                 // Checkpoints committed to the disk
+} bench_count_t;
+
+// --------------- Public global data holders initializations --------------- //
+
+const char coms[] = "ETH";
+
+// -------------- Private global data holders initializations --------------- //
+
+static int   n_tests   = N_TESTS;
+static int   resp_size = DEF_RESP_SIZE;
+static int   read_size = DEF_READ_SIZE;
+static char *resp      = NULL;
+
+// --------------------- Private functions declarations --------------------- //
+
+static int write_report(int buffered, bench_count_t *c);
+static void put_test(FILE *txt, int num, int buffered);
+static void put_check(FILE *txt, int buffered, bench_count_t *c);
+static int get_counters(ULONGLONG *writes, ULONGLONG *bytes);
+
+// ---------------------- Public functions definitions ---------------------- //
+
+int main(int argc, char *argv[]) {
+    // Take the arguments, if given.
+    if (argc > 1) {
+        n_tests = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        resp_size = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        read_size = atoi(argv[3]);
+    }
+    if (n_tests < 1 || resp_size < 1 || read_size < 1) {
+        fprintf(stderr, "Usage: report_bench [tests] [response bytes per test] "
+                "[bytes per read]\n");
+
+        return 1;
+    }
+
+    // Build a verbose response: lines of printable text.
+    resp = malloc(resp_size);
+    if (resp == NULL) {
+        return 1;
+    }
+    for (int i = 0; i < resp_size; i++) {
+        resp[i] = (i % LINE_LEN == LINE_LEN - 1) ? '\n' : 'a' + i % 26;
+    }
+
+    // Write the report both ways and print the counts.
+    bench_count_t before = {0};
+    bench_count_t after  = {0};
+    int ret  = write_report(FALSE, &before);
+    ret     |= write_report(TRUE, &after);
+    remove(BENCH_FILE);
+    if (ret != 0) {
+        fprintf(stderr, "The report could not be written.\n");
+
+        return 1;
+    }
+    printf("Report     : %i tests, %i response bytes each, %i bytes per "
+            "read\n", n_tests, resp_size, read_size);
+    printf("             WriteFile calls   Checkpoints   Bytes\n");
+    printf("Unbuffered : %-17llu %-13i %llu\n", before.writes, before.commits,
+            before.bytes);
+    printf("Buffered   : %-17llu %-13i %llu\n", after.writes, after.commits,
+            after.bytes);
+    if (after.writes > 0) {
+        printf("Reduction  : %.0fx fewer WriteFile calls\n",
+                (double)before.writes / after.writes);
+    }
+
+    return 0;
+}
+
+// Stubs of the functions of the program used by the output functions.
+
+void prof_mark(prof_mark_t *m) {
+    // Nothing is profiled.
+}
+
+void prof_add(const prof_mark_t *m, prof_bucket_t b) {
+    // Nothing is profiled.
+}
+
+void kill_program(void) {
+    // End the program.
+    exit(1);
+}
+
+// --------------------- Private functions definitions ---------------------- //
+
+static int write_report(int buffered, bench_count_t *c) {
+    // Write a report like the full test modes do, from the opening of the file
+    // to its closing, counting the writes of the process meanwhile.
+    ULONGLONG writes = 0;
+    ULONGLONG bytes  = 0;
+    int ret = get_counters(&writes, &bytes);
+    if (ret != 0) {
+        return 1;
+    }
+    FILE *txt = fopen(BENCH_FILE, "w");
+    if (txt == NULL) {
+        return 1;
+    }
+    if (buffered == TRUE) {
+        setvbuf(txt, NULL, _IOFBF, REPORT_BUF_SIZE);
+    } else {
+        setvbuf(txt, NULL, _IONBF, 0);
+    }
+    write_header(NULL, txt, "HWTT");
+    show_version(NULL, txt);
+    write_header(NULL, txt, "Tests");
+    put_check(txt, buffered, c);
+    for (int i = 0; i < n_tests; i++) {
+        put_test(txt, i, buffered);
+        put_check(txt, buffered, c);
+    }
+    write_header(NULL, txt, "Tests Completed");
+    for (int i = 0; i < n_tests; i++) {
+        char res[DEF_SMA_BUF_SIZE] = {0};
+        sprintf(res, " -> Test %02i .................. PASS\n", i);
+        output(NULL, txt, res);
+    }
+    ret = fclose(txt);
+    ret |= get_counters(&c->writes, &c->bytes);
+    c->writes -= writes;
+    c->bytes  -= bytes;
+
+    return (ret != 0);
+}
+
+static void put_test(FILE *txt, int num, int buffered) {
+    // Print the request and the response of a test: the response byte by byte
+    // as before, or as the contiguous bytes taken from each read as now.
+    char req[DEF_SMA_BUF_SIZE] = {0};
+    sprintf(req, "T_%02i", num);
+    write_header(NULL, txt, req);
+    output(NULL, txt, " >> ");
+    output(NULL, txt, req);
+    output(NULL, txt, "\n");
+    output(NULL, txt, " << ");
+    for (int i = 0; i < resp_size; ) {
+        if (buffered == FALSE) {
+            char str[] = {resp[i], 0};
+            output(NULL, txt, str);
+            i++;
+        } else {
+            int n = (resp_size - i < read_size) ? resp_size - i : read_size;
+            output_buf(NULL, txt, &resp[i], n);
+            i += n;
+        }
+    }
+    output(NULL, txt, "P_");
+    output(NULL, txt, &req[2]);
+    output(NULL, txt, HWTT_TEST_END);
+    output(NULL, txt, "\n");
+}
+
+static void put_check(FILE *txt, int buffered, bench_count_t *c) {
+    // Write the buffered report to its file and commit it to the disk, like
+    // the checkpoints of the full test modes (the unbuffered one had none).
+    if (buffered == FALSE) {
+        return;
+    }
+    fflush(txt);
+    _commit(_fileno(txt));
+    c->commits++;
+}
+
+static int get_counters(ULONGLONG *writes, ULONGLONG *bytes) {
+    // Get the number of write operations of the process and their bytes.
+    IO_COUNTERS io = {0};
+    BOOL ok = GetProcessIoCounters(GetCurrentProcess(), &io);
+    if (ok == FALSE) {
+        return 1;
+    }
+    *writes = io.WriteOperationCount;
+    *bytes  = io.WriteTransferCount;
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+#endif // WIN32